@@ -0,0 +1,125 @@
+///////////////////////////////////////////////////////////////////////////////////////////////
+// Generated by host/assetgen from fonts.txt and sprites.txt, edit those and run make in host/ instead
+// Glyph columns and sprite shifts are packed page by page with a run length code, see unpackByte()
+///////////////////////////////////////////////////////////////////////////////////////////////
+
+// FontLarge: 14 glyphs, 144 bytes packed from 162
+const unsigned char FontLargeBitmaps[] PROGMEM = {
+	0x00, 0xFF, 0x82, 0x41, 0x01, 0x3E, 0xFF, 0x83, 0x00, 0x00, 0xFF, 0x82, 0x00, 0x01, 0xFF, 0xFF,
+	0x82, 0x80, 0x00, 0xFF, 0x00, 0xFF, 0x83, 0x81, 0x83, 0x80, 0x00, 0xFF, 0x00, 0xFF, 0x82, 0x80,
+	0x01, 0xFF, 0xFF, 0x82, 0x00, 0x00, 0xFF, 0x81, 0x01, 0x00, 0xFF, 0x81, 0x01, 0x81, 0x00, 0x00,
+	0xFF, 0x81, 0x00, 0x00, 0xFF, 0x82, 0x01, 0x01, 0xFF, 0xFF, 0x82, 0x80, 0x00, 0xFF, 0x81, 0x01,
+	0x00, 0xFF, 0x81, 0x01, 0x81, 0x80, 0x00, 0xFF, 0x81, 0x80, 0x00, 0xFF, 0x83, 0x01, 0x00, 0xFF,
+	0x83, 0x80, 0x0B, 0xFF, 0x80, 0x40, 0x30, 0x0C, 0x03, 0xFF, 0x01, 0x02, 0x0C, 0x30, 0xC0, 0x00,
+	0xFF, 0x82, 0x81, 0x01, 0xFF, 0xFF, 0x82, 0x00, 0x00, 0xFF, 0x01, 0xFF, 0xC1, 0x81, 0x41, 0x06,
+	0x3E, 0xFF, 0x00, 0x03, 0x0C, 0x30, 0xC0, 0x00, 0xFF, 0x82, 0x81, 0x01, 0x01, 0xFF, 0x83, 0x80,
+	0x0B, 0xFF, 0x0F, 0xF0, 0x00, 0x00, 0xFF, 0xFF, 0x00, 0x00, 0x0F, 0xF0, 0xFF, 0x01, 0x00, 0x00
+};
+
+const Glyph FontLargeGlyphs[] PROGMEM = {
+	{ 'P', 6, 0 }, { 'U', 6, 9 }, { 'S', 6, 20 }, { 'H', 6, 28 }, { 'T', 7, 39 }, { 'O', 6, 51 },
+	{ 'I', 7, 62 }, { 'C', 6, 74 }, { 'K', 6, 82 }, { 'A', 6, 95 }, { 'R', 6, 106 }, { 'E', 6, 119 },
+	{ 'N', 6, 128 }, { ' ', 1, 141 }
+};
+
+const Font FontLarge PROGMEM = { 2, 1, 14, 1, FontLargeGlyphs, FontLargeBitmaps };
+
+// FontSmall: 18 glyphs, 76 bytes, not packed as that would take 90
+const unsigned char FontSmallBitmaps[] PROGMEM = {
+	0x8F, 0x89, 0x89, 0x89, 0xF9, 0xFF, 0x81, 0x81, 0x81, 0x81, 0xFF, 0x81, 0x81, 0x81, 0xFF, 0xFF,
+	0x19, 0x29, 0x49, 0x86, 0xFF, 0x89, 0x89, 0x89, 0x81, 0xFF, 0x89, 0x89, 0x89, 0x76, 0x01, 0x01,
+	0xFF, 0x01, 0x01, 0x24, 0xFF, 0x81, 0x81, 0xFF, 0x00, 0xFF, 0x00, 0x00, 0xF9, 0x89, 0x89, 0x8F,
+	0x89, 0x89, 0x89, 0xFF, 0x0F, 0x08, 0x08, 0xFF, 0x8F, 0x89, 0x89, 0xF9, 0xFF, 0x89, 0x89, 0xF9,
+	0x01, 0x01, 0x01, 0xFF, 0xFF, 0x89, 0x89, 0xFF, 0x0F, 0x09, 0x09, 0xFF
+};
+
+const Glyph FontSmallGlyphs[] PROGMEM = {
+	{ 'S', 5, 0 }, { 'C', 5, 5 }, { 'O', 5, 10 }, { 'R', 5, 15 }, { 'E', 5, 20 }, { 'B', 5, 25 },
+	{ 'T', 5, 30 }, { ':', 1, 35 }, { '0', 4, 36 }, { '1', 4, 40 }, { '2', 4, 44 }, { '3', 4, 48 },
+	{ '4', 4, 52 }, { '5', 4, 56 }, { '6', 4, 60 }, { '7', 4, 64 }, { '8', 4, 68 }, { '9', 4, 72 }
+};
+
+const Font FontSmall PROGMEM = { 1, 2, 18, 0, FontSmallGlyphs, FontSmallBitmaps };
+
+// Sprites: 7 sprites, 662 bytes packed from 966
+#define SPRITE_REX 0
+#define SPRITE_CACTUS 1
+#define SPRITE_PTERODACTYL 2
+#define SPRITE_DUCK_ONE 3
+#define SPRITE_DUCK_TWO 4
+#define SPRITE_DUCK_THREE 5
+#define SPRITE_DUCK_FOUR 6
+
+const unsigned char RexAtlas[] PROGMEM = {
+	0x1B, 0xE0, 0xC0, 0x80, 0x00, 0x00, 0x80, 0xC0, 0xC0, 0xE0, 0xF8, 0xFC, 0x74, 0x5C, 0x5C, 0x18,
+	0x03, 0x07, 0x07, 0x0F, 0xFF, 0xBF, 0x1F, 0x0F, 0x1F, 0xFF, 0x87, 0x01, 0x03, 0x8F, 0x00, 0x01,
+	0xC0, 0x80, 0x82, 0x00, 0x15, 0x80, 0x80, 0xC0, 0xF0, 0xF8, 0xE8, 0xB8, 0xB8, 0x30, 0x07, 0x0F,
+	0x0F, 0x1E, 0xFE, 0x7F, 0x3F, 0x1F, 0x3F, 0xFF, 0x0F, 0x02, 0x06, 0x84, 0x00, 0x01, 0x01, 0x01,
+	0x81, 0x00, 0x01, 0x01, 0x01, 0x82, 0x00, 0x00, 0x80, 0x85, 0x00, 0x14, 0x80, 0xE0, 0xF0, 0xD0,
+	0x70, 0x70, 0x60, 0x0F, 0x1F, 0x1E, 0x3C, 0xFC, 0xFE, 0x7F, 0x3F, 0x7F, 0xFF, 0x1F, 0x05, 0x0D,
+	0x01, 0x83, 0x00, 0x01, 0x03, 0x02, 0x81, 0x00, 0x01, 0x03, 0x02, 0x82, 0x00, 0x87, 0x00, 0x13,
+	0xC0, 0xE0, 0xA0, 0xE0, 0xE0, 0xC0, 0x1F, 0x3E, 0x3C, 0x78, 0xF8, 0xFC, 0xFE, 0x7E, 0xFF, 0xFF,
+	0x3F, 0x0B, 0x1A, 0x02, 0x83, 0x00, 0x01, 0x07, 0x05, 0x81, 0x00, 0x01, 0x07, 0x04, 0x82, 0x00,
+	0x87, 0x00, 0x14, 0x80, 0xC0, 0x40, 0xC0, 0xC0, 0x80, 0x3E, 0x7C, 0x78, 0xF0, 0xF0, 0xF8, 0xFC,
+	0xFC, 0xFE, 0xFF, 0x7F, 0x17, 0x35, 0x05, 0x01, 0x82, 0x00, 0x06, 0x0F, 0x0B, 0x01, 0x00, 0x01,
+	0x0F, 0x08, 0x82, 0x00, 0x88, 0x00, 0x82, 0x80, 0x0F, 0x00, 0x7C, 0xF8, 0xF0, 0xE0, 0xE0, 0xF0,
+	0xF8, 0xF8, 0xFC, 0xFF, 0xFF, 0x2E, 0x6B, 0x0B, 0x03, 0x81, 0x00, 0x07, 0x01, 0x1F, 0x17, 0x03,
+	0x01, 0x03, 0x1F, 0x10, 0x82, 0x00, 0x8D, 0x00, 0x19, 0xF8, 0xF0, 0xE0, 0xC0, 0xC0, 0xE0, 0xF0,
+	0xF0, 0xF8, 0xFE, 0xFF, 0x5D, 0xD7, 0x17, 0x06, 0x00, 0x01, 0x01, 0x03, 0x3F, 0x2F, 0x07, 0x03,
+	0x07, 0x3F, 0x21, 0x82, 0x00, 0x8D, 0x00, 0x1D, 0xF0, 0xE0, 0xC0, 0x80, 0x80, 0xC0, 0xE0, 0xE0,
+	0xF0, 0xFC, 0xFE, 0xBA, 0xAE, 0x2E, 0x0C, 0x01, 0x03, 0x03, 0x07, 0x7F, 0x5F, 0x0F, 0x07, 0x0F,
+	0x7F, 0x43, 0x00, 0x01, 0x00, 0x00
+};
+
+const unsigned char CactusAtlas[] PROGMEM = {
+	0x0B, 0x00, 0x00, 0xE0, 0xE0, 0x00, 0x00, 0x0F, 0x08, 0xFF, 0xFF, 0x08, 0x0F, 0x84, 0x00, 0x11,
+	0x00, 0x00, 0xC0, 0xC0, 0x00, 0x00, 0x1E, 0x10, 0xFF, 0xFF, 0x10, 0x1E, 0x00, 0x00, 0x01, 0x01,
+	0x00, 0x00, 0x11, 0x00, 0x00, 0x80, 0x80, 0x00, 0x00, 0x3C, 0x20, 0xFF, 0xFF, 0x20, 0x3C, 0x00,
+	0x00, 0x03, 0x03, 0x00, 0x00, 0x84, 0x00, 0x0B, 0x78, 0x40, 0xFF, 0xFF, 0x40, 0x78, 0x00, 0x00,
+	0x07, 0x07, 0x00, 0x00, 0x84, 0x00, 0x0B, 0xF0, 0x80, 0xFE, 0xFE, 0x80, 0xF0, 0x00, 0x00, 0x0F,
+	0x0F, 0x00, 0x00, 0x84, 0x00, 0x0B, 0xE0, 0x00, 0xFC, 0xFC, 0x00, 0xE0, 0x01, 0x01, 0x1F, 0x1F,
+	0x01, 0x01, 0x84, 0x00, 0x0B, 0xC0, 0x00, 0xF8, 0xF8, 0x00, 0xC0, 0x03, 0x02, 0x3F, 0x3F, 0x02,
+	0x03, 0x84, 0x00, 0x0B, 0x80, 0x00, 0xF0, 0xF0, 0x00, 0x80, 0x07, 0x04, 0x7F, 0x7F, 0x04, 0x07
+};
+
+const unsigned char PterodactylAtlas[] PROGMEM = {
+	0x0A, 0x04, 0x06, 0x07, 0x0C, 0xFC, 0x7C, 0x1C, 0x1C, 0x14, 0x14, 0x04, 0x94, 0x00, 0x0A, 0x08,
+	0x0C, 0x0E, 0x18, 0xF8, 0xF8, 0x38, 0x38, 0x28, 0x28, 0x08, 0x82, 0x00, 0x00, 0x01, 0x8F, 0x00,
+	0x0A, 0x10, 0x18, 0x1C, 0x30, 0xF0, 0xF0, 0x70, 0x70, 0x50, 0x50, 0x10, 0x82, 0x00, 0x01, 0x03,
+	0x01, 0x8E, 0x00, 0x03, 0x20, 0x30, 0x38, 0x60, 0x82, 0xE0, 0x02, 0xA0, 0xA0, 0x20, 0x82, 0x00,
+	0x01, 0x07, 0x03, 0x8E, 0x00, 0x02, 0x40, 0x60, 0x70, 0x83, 0xC0, 0x81, 0x40, 0x82, 0x00, 0x01,
+	0x0F, 0x07, 0x82, 0x01, 0x8A, 0x00, 0x02, 0x80, 0xC0, 0xE0, 0x86, 0x80, 0x81, 0x00, 0x06, 0x01,
+	0x1F, 0x0F, 0x03, 0x03, 0x02, 0x02, 0x8A, 0x00, 0x02, 0x00, 0x80, 0xC0, 0x86, 0x00, 0x81, 0x01,
+	0x07, 0x03, 0x3F, 0x1F, 0x07, 0x07, 0x05, 0x05, 0x01, 0x89, 0x00, 0x02, 0x00, 0x00, 0x80, 0x86,
+	0x00, 0x0A, 0x02, 0x03, 0x03, 0x06, 0x7E, 0x3E, 0x0E, 0x0E, 0x0A, 0x0A, 0x02, 0x89, 0x00
+};
+
+const unsigned char DuckOneAtlas[] PROGMEM = {
+	0x01, 0x80, 0x80, 0x81, 0x00, 0x00, 0x80, 0x81, 0xC0, 0x12, 0xF0, 0xF8, 0xE8, 0xB8, 0xB8, 0x30,
+	0x03, 0x03, 0x07, 0x07, 0xFF, 0xBF, 0x1F, 0x0F, 0x1F, 0xFF, 0x87, 0x02, 0x06, 0x8F, 0x00
+};
+
+const unsigned char DuckTwoAtlas[] PROGMEM = {
+	0x84, 0x00, 0x82, 0x80, 0x05, 0xE0, 0xF0, 0xD0, 0x70, 0x70, 0x60, 0x82, 0x0F, 0x0A, 0xFF, 0xBF,
+	0x1F, 0x0F, 0x1F, 0xFF, 0x87, 0x05, 0x0D, 0x01, 0x01, 0x8F, 0x00
+};
+
+const unsigned char DuckThreeAtlas[] PROGMEM = {
+	0x83, 0x00, 0x82, 0x80, 0x18, 0x00, 0x00, 0x80, 0xC0, 0x40, 0xC0, 0xC0, 0x80, 0x1E, 0x1E, 0x0F,
+	0x0F, 0xFF, 0xBF, 0x1F, 0x0F, 0x1F, 0xFF, 0x87, 0x1F, 0x17, 0x07, 0x05, 0x05, 0x01, 0x8F, 0x00
+};
+
+const unsigned char DuckFourAtlas[] PROGMEM = {
+	0x90, 0x00, 0x11, 0xF8, 0x7C, 0x3C, 0x1E, 0xFF, 0xBF, 0x1F, 0x0F, 0x1F, 0xFF, 0x8E, 0x3E, 0x2F,
+	0x0F, 0x1D, 0x17, 0x17, 0x06, 0x90, 0x00
+};
+
+const Sprite Sprites[] PROGMEM = {
+	{ 15, 8, RexAtlas, { 0, 31, 71, 109, 144, 180, 214, 245 } },
+	{ 6, 8, CactusAtlas, { 0, 15, 34, 53, 68, 83, 98, 113 } },
+	{ 11, 8, PterodactylAtlas, { 0, 14, 32, 51, 69, 86, 104, 123 } },
+	{ 15, 1, DuckOneAtlas, { 0 } },
+	{ 16, 1, DuckTwoAtlas, { 0 } },
+	{ 17, 1, DuckThreeAtlas, { 0 } },
+	{ 18, 1, DuckFourAtlas, { 0 } }
+};
@@ -0,0 +1,83 @@
+///////////////////////////////////////////////////////////////////////////////////////////////
+// Hardware abstraction layer for Dino Dash
+// Description: Names every pin the game touches so main.c never pokes port bits directly
+//				On the ATmega328P these map straight onto the port registers
+//				When HOST_SIM is defined the same names are backed by the host simulator
+//				in host/ so the game can be built and benchmarked on Linux
+///////////////////////////////////////////////////////////////////////////////////////////////
+#ifndef HAL_H
+#define HAL_H
+
+#include <avr/io.h>
+#include <avr/interrupt.h>
+#include <avr/sleep.h>
+
+// Pin assignments
+#define RESET_PIN	0x04	// PC2, wired to the reset line
+#define STICK_PIN	0x40	// PD6, joystick push button (active low), PCINT22
+#define TOUCH_PIN	0x08	// PD3, capacitive touch sensor on INT1, PCINT19
+#define LED_PIN		0x10	// PD4, jump LED
+#define BUZZER_PIN	0x80	// PD7, active buzzer
+
+// Port macros
+#define RESET_OUTPUT()		(DDRC |= RESET_PIN)
+#define LED_OUTPUT()		(DDRD |= LED_PIN)
+#define BUZZER_OUTPUT()		(DDRD |= BUZZER_PIN)
+#define RESET_HIGH()		(PORTC |= RESET_PIN)
+#define STICK_PRESSED()		((PIND & STICK_PIN) == 0)
+#define TOUCH_HELD()		((PIND & TOUCH_PIN) != 0)
+#define LED_ON()			(PORTD |= LED_PIN)
+#define LED_OFF()			(PORTD &= ~(LED_PIN))
+#define BUZZER_ON()			(PORTD |= BUZZER_PIN)
+#define BUZZER_OFF()		(PORTD &= ~(BUZZER_PIN))
+
+#ifdef HOST_SIM
+
+#include "sim.h"
+
+// The simulator owns the real main() and calls into the game through dino_main()
+#define main dino_main
+
+// Marks the end of one rendered frame so the simulator can close its per frame counters
+#define HAL_FRAME_END()		sim_frame_end()
+
+// Enables interrupts and waits for one, the simulator has no window between the two
+#define HAL_IDLE_SEI()		do { sei(); sim_idle(); } while (0)
+
+// Writes to TWCR start bus operations, the simulator has to see them happen
+#define TWI_COMMAND(bits)	sim_twi_command(bits)
+
+// Bytes written to UDR0 go to the simulator's UART output
+#define UART_WRITE(byte)	sim_uart_write(byte)
+
+// Starts an EEPROM write, the simulator times it and raises EE_READY_vect when it is done
+#define EEPROM_WRITE(address, byte)	sim_eeprom_write((address), (byte))
+
+#else
+
+// Nothing to record on the board
+#define HAL_FRAME_END()
+
+// Enables interrupts and sleeps in idle mode, for a caller that checked with interrupts off:
+// SMCR is left on idle mode, so the timers, the TWI and the ADC keep running and any interrupt
+// ends the sleep, and the instruction after sei() runs before any interrupt, so none can slip in
+// ahead of the sleep
+#define HAL_IDLE_SEI()		do { sleep_enable(); sei(); sleep_cpu(); sleep_disable(); } while (0)
+
+// Starts the next operation of the TWI hardware
+#define TWI_COMMAND(bits)	(TWCR = (bits))
+
+// Sends a byte on the UART
+#define UART_WRITE(byte)	(UDR0 = (byte))
+
+// Starts an EEPROM write, EEPE has to follow EEMPE within four cycles
+#define EEPROM_WRITE(address, byte)	do { EEAR = (address); EEDR = (byte); EECR |= (1 << EEMPE); EECR |= (1 << EEPE); } while (0)
+
+#endif
+
+// Sleeps until the condition no longer holds, checking it again after every interrupt
+// It is checked with interrupts off, so an interrupt that changes it between the check and the
+// sleep still ends the sleep
+#define HAL_IDLE_WHILE(condition)	do { cli(); while (condition) { HAL_IDLE_SEI(); cli(); } sei(); } while (0)
+
+#endif
@@ -0,0 +1,425 @@
+/*
+ * Packs the Dino Dash fonts and sprites into PROGMEM tables
+ *
+ * Reads the glyph drawings of fonts.txt and the sprite drawings of sprites.txt
+ * and writes assets.h, which main.c includes. Every glyph is stored as its
+ * columns page by page, top page first, the way drawGlyph() streams them to the
+ * framebuffer, and compressed with a PackBits style run length code:
+ *   0x00-0x7F  the next header + 1 bytes are copied
+ *   0x80-0xFF  the next byte is repeated header - 0x80 + 2 times
+ * A glyph's tokens never reach into the next glyph, so each can be unpacked on
+ * its own from the offset in its font's glyph table. A font whose glyphs are
+ * too small to gain from the code (a one page font of four column digits) is
+ * stored as it is instead, and marked so in its Font entry.
+ *
+ * A sprite is stored as an atlas: for every shift, the sprite moved down that
+ * many pixels as three pages of columns, the way blitSprite() draws them. Each
+ * shift is packed on its own with the same code and found from the offsets in
+ * the sprite's Sprite entry. The empty rows above and below a shifted copy
+ * always pack, so sprites are never stored unpacked.
+ *
+ *   assetgen FONTS SPRITES OUTPUT
+ */
+#include <ctype.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define MAX_FONTS 8
+#define MAX_GLYPHS 64
+#define MAX_WIDTH 32
+#define MAX_PAGES 4
+#define MAX_PACKED 256		/* glyph offsets are one byte */
+#define MAX_SPRITES 16
+#define MAX_SHIFTS 8
+#define MAX_ATLAS 512		/* shift offsets are one byte, the last shift may run past them */
+#define LONGEST_COPY 128
+#define LONGEST_REPEAT 129
+#define SHORTEST_REPEAT 3	/* a run of two costs as much copied as repeated */
+
+typedef struct {
+	char code;
+	uint8_t width;
+	uint8_t packed_offset;
+	uint8_t raw_offset;
+} glyph_t;
+
+typedef struct {
+	char name[32];
+	uint8_t pages;
+	uint8_t spacing;
+	glyph_t glyphs[MAX_GLYPHS];
+	uint8_t count;
+	uint8_t packed[MAX_PACKED];
+	size_t packed_size;
+	uint8_t raw[MAX_PACKED];
+	size_t raw_size;
+} font_t;
+
+typedef struct {
+	char name[32];
+	uint8_t width;
+	uint8_t shifts;
+	uint8_t offsets[MAX_SHIFTS];	/* first byte of every shift in packed */
+	uint8_t packed[MAX_ATLAS];
+	size_t packed_size;
+	size_t raw_size;
+} sprite_t;
+
+static font_t fonts[MAX_FONTS];
+static uint8_t font_count;
+static sprite_t sprites[MAX_SPRITES];
+static uint8_t sprite_count;
+
+static const char *path;
+static unsigned line_number;
+
+static void fail(const char *message)
+{
+	fprintf(stderr, "%s:%u: %s\n", path, line_number, message);
+	exit(1);
+}
+
+static void emit(uint8_t *out, size_t *size, size_t capacity, uint8_t byte)
+{
+	if (*size == capacity) {
+		fail("packs to more bytes than its offsets can reach, split it");
+	}
+	out[(*size)++] = byte;
+}
+
+/* Packs length bytes onto the end of out, which holds size bytes and has room for capacity */
+static size_t pack(uint8_t *out, size_t size, size_t capacity, const uint8_t *bytes, size_t length)
+{
+	size_t i = 0;
+
+	while (i < length) {
+		size_t run = 1;
+		while (i + run < length && bytes[i + run] == bytes[i] && run < LONGEST_REPEAT) {
+			run++;
+		}
+		if (run >= SHORTEST_REPEAT) {
+			emit(out, &size, capacity, (uint8_t)(0x80 + run - 2));
+			emit(out, &size, capacity, bytes[i]);
+			i += run;
+			continue;
+		}
+		/* Copy up to the next run worth repeating */
+		size_t copy = 0;
+		while (i + copy < length && copy < LONGEST_COPY) {
+			size_t ahead = 1;
+			while (i + copy + ahead < length && bytes[i + copy + ahead] == bytes[i + copy] && ahead < SHORTEST_REPEAT) {
+				ahead++;
+			}
+			if (ahead >= SHORTEST_REPEAT) {
+				break;
+			}
+			copy++;
+		}
+		emit(out, &size, capacity, (uint8_t)(copy - 1));
+		for (size_t j = 0; j < copy; j++) {
+			emit(out, &size, capacity, bytes[i + j]);
+		}
+		i += copy;
+	}
+	return size;
+}
+
+/* Reads the next line that is not blank or a comment, returns 0 at the end of the file */
+static int next_line(FILE *in, char *line, size_t size)
+{
+	while (fgets(line, (int)size, in)) {
+		line_number++;
+		line[strcspn(line, "\r\n")] = '\0';
+		if (line[0] != '\0' && strncmp(line, "//", 2) != 0) {
+			return 1;
+		}
+	}
+	return 0;
+}
+
+/* Reads a drawing pages * 8 rows high into columns, page by page, returns its width */
+static size_t read_drawing(FILE *in, unsigned pages, uint8_t *columns)
+{
+	char line[MAX_WIDTH + 8];
+	size_t width = 0;
+
+	memset(columns, 0, MAX_PAGES * MAX_WIDTH);
+	for (unsigned row = 0; row < pages * 8u; row++) {
+		if (!next_line(in, line, sizeof(line))) {
+			fail("drawing cut short by the end of the file");
+		}
+		if (row == 0) {
+			width = strlen(line);
+			if (width == 0 || width > MAX_WIDTH) {
+				fail("drawing is wider than 32 columns");
+			}
+		}
+		if (strlen(line) != width || strspn(line, "#.") != width) {
+			fail("drawing rows must be # and . and all the same width");
+		}
+		for (size_t x = 0; x < width; x++) {
+			if (line[x] == '#') {
+				columns[(row / 8) * width + x] |= (uint8_t)(1 << (row % 8));
+			}
+		}
+	}
+	return width;
+}
+
+static void read_glyph(FILE *in, font_t *font, const char *name)
+{
+	uint8_t columns[MAX_PAGES * MAX_WIDTH];
+	size_t width;
+	glyph_t *glyph;
+
+	if (font->count == MAX_GLYPHS) {
+		fail("too many glyphs in one font");
+	}
+	glyph = &font->glyphs[font->count++];
+	if (!strcmp(name, "space")) {
+		glyph->code = ' ';
+	}
+	else if (strlen(name) == 1 && isprint((unsigned char)name[0])) {
+		glyph->code = name[0];
+	}
+	else {
+		fail("a glyph is named by one character or \"space\"");
+	}
+	for (uint8_t i = 0; i + 1 < font->count; i++) {
+		if (font->glyphs[i].code == glyph->code) {
+			fail("glyph drawn twice");
+		}
+	}
+
+	width = read_drawing(in, font->pages, columns);
+	glyph->width = (uint8_t)width;
+	glyph->packed_offset = (uint8_t)font->packed_size;
+	font->packed_size = pack(font->packed, font->packed_size, MAX_PACKED, columns, font->pages * width);
+	if (font->raw_size + font->pages * width > MAX_PACKED) {
+		fail("font is more than 256 bytes, split it");
+	}
+	glyph->raw_offset = (uint8_t)font->raw_size;
+	memcpy(font->raw + font->raw_size, columns, font->pages * width);
+	font->raw_size += font->pages * width;
+}
+
+/* A sprite is drawn two pages high, every shift of it is three pages: the top, middle and bottom
+ * bytes of each column moved down by the shift */
+static void read_sprite(FILE *in, const char *name, unsigned shifts)
+{
+	uint8_t columns[MAX_PAGES * MAX_WIDTH];
+	uint8_t atlas[3 * MAX_WIDTH];
+	size_t width;
+	sprite_t *sprite;
+
+	if (sprite_count == MAX_SPRITES) {
+		fail("too many sprites");
+	}
+	if (shifts != 1 && shifts != MAX_SHIFTS) {
+		fail("a sprite keeps 1 or 8 shifts");
+	}
+	sprite = &sprites[sprite_count++];
+	snprintf(sprite->name, sizeof(sprite->name), "%s", name);
+	sprite->shifts = (uint8_t)shifts;
+	width = read_drawing(in, 2, columns);
+	sprite->width = (uint8_t)width;
+	for (unsigned shift = 0; shift < shifts; shift++) {
+		for (size_t x = 0; x < width; x++) {
+			unsigned pixels = (unsigned)(columns[x] | (columns[width + x] << 8)) << shift;
+			atlas[x] = (uint8_t)pixels;
+			atlas[width + x] = (uint8_t)(pixels >> 8);
+			atlas[2 * width + x] = (uint8_t)(pixels >> 16);
+		}
+		if (sprite->packed_size > 0xFF) {
+			fail("sprite packs too large for one byte offsets, give it fewer shifts");
+		}
+		sprite->offsets[shift] = (uint8_t)sprite->packed_size;
+		sprite->packed_size = pack(sprite->packed, sprite->packed_size, MAX_ATLAS, atlas, 3 * width);
+		sprite->raw_size += 3 * width;
+	}
+}
+
+/* Packing only pays when it makes the font smaller */
+static int is_packed(const font_t *font)
+{
+	return font->packed_size < font->raw_size;
+}
+
+static void read_assets(FILE *in)
+{
+	char line[128];
+	font_t *font = NULL;
+
+	while (next_line(in, line, sizeof(line))) {
+		char name[32];
+		unsigned pages, spacing, shifts;
+
+		if (sscanf(line, "font %31s pages %u spacing %u", name, &pages, &spacing) == 3) {
+			if (font_count == MAX_FONTS) {
+				fail("too many fonts");
+			}
+			if (pages == 0 || pages > MAX_PAGES || spacing > 8) {
+				fail("a font is 1 to 4 pages high with up to 8 columns of spacing");
+			}
+			font = &fonts[font_count++];
+			snprintf(font->name, sizeof(font->name), "%s", name);
+			font->pages = (uint8_t)pages;
+			font->spacing = (uint8_t)spacing;
+		}
+		else if (sscanf(line, "glyph %31s", name) == 1) {
+			if (!font) {
+				fail("glyph before the first font line");
+			}
+			read_glyph(in, font, name);
+		}
+		else if (sscanf(line, "sprite %31s shifts %u", name, &shifts) == 2) {
+			read_sprite(in, name, shifts);
+		}
+		else {
+			fail("expected a font, glyph or sprite line");
+		}
+	}
+}
+
+static void write_char(FILE *out, char code)
+{
+	if (code == '\'' || code == '\\') {
+		fprintf(out, "'\\%c'", code);
+	}
+	else {
+		fprintf(out, "'%c'", code);
+	}
+}
+
+/* SPRITE_ and the words of a CamelCase name in capitals, DuckOne is SPRITE_DUCK_ONE */
+static void write_sprite_index(FILE *out, const char *name)
+{
+	fputs("SPRITE_", out);
+	for (size_t i = 0; name[i]; i++) {
+		if (i > 0 && isupper((unsigned char)name[i])) {
+			fputc('_', out);
+		}
+		fputc(toupper((unsigned char)name[i]), out);
+	}
+}
+
+static void write_sprites(FILE *out)
+{
+	size_t packed = 0, raw = 0;
+
+	if (sprite_count == 0) {
+		return;
+	}
+	for (uint8_t i = 0; i < sprite_count; i++) {
+		packed += sprites[i].packed_size;
+		raw += sprites[i].raw_size;
+	}
+	fprintf(out, "\n// Sprites: %u sprites, %zu bytes packed from %zu\n", sprite_count, packed, raw);
+	for (uint8_t i = 0; i < sprite_count; i++) {
+		fputs("#define ", out);
+		write_sprite_index(out, sprites[i].name);
+		fprintf(out, " %u\n", i);
+	}
+	for (uint8_t i = 0; i < sprite_count; i++) {
+		const sprite_t *sprite = &sprites[i];
+
+		fprintf(out, "\nconst unsigned char %sAtlas[] PROGMEM = {", sprite->name);
+		for (size_t j = 0; j < sprite->packed_size; j++) {
+			fprintf(out, "%s0x%02X%s", (j % 16) ? " " : "\n\t", sprite->packed[j], (j + 1 < sprite->packed_size) ? "," : "");
+		}
+		fprintf(out, "\n};\n");
+	}
+	fprintf(out, "\nconst Sprite Sprites[] PROGMEM = {");
+	for (uint8_t i = 0; i < sprite_count; i++) {
+		const sprite_t *sprite = &sprites[i];
+
+		fprintf(out, "\n\t{ %u, %u, %sAtlas, {", sprite->width, sprite->shifts, sprite->name);
+		for (uint8_t shift = 0; shift < sprite->shifts; shift++) {
+			fprintf(out, " %u%s", sprite->offsets[shift], (shift + 1 < sprite->shifts) ? "," : "");
+		}
+		fprintf(out, " } }%s", (i + 1 < sprite_count) ? "," : "");
+	}
+	fprintf(out, "\n};\n");
+}
+
+static void write_header(FILE *out)
+{
+	fprintf(out,
+		"///////////////////////////////////////////////////////////////////////////////////////////////\n"
+		"// Generated by host/assetgen from fonts.txt and sprites.txt, edit those and run make in host/ instead\n"
+		"// Glyph columns and sprite shifts are packed page by page with a run length code, see unpackByte()\n"
+		"///////////////////////////////////////////////////////////////////////////////////////////////\n");
+	for (uint8_t f = 0; f < font_count; f++) {
+		const font_t *font = &fonts[f];
+		int packed = is_packed(font);
+		const uint8_t *bytes = packed ? font->packed : font->raw;
+		size_t size = packed ? font->packed_size : font->raw_size;
+
+		if (packed) {
+			fprintf(out, "\n// %s: %u glyphs, %zu bytes packed from %zu\n", font->name, font->count, size, font->raw_size);
+		}
+		else {
+			fprintf(out, "\n// %s: %u glyphs, %zu bytes, not packed as that would take %zu\n", font->name, font->count,
+				size, font->packed_size);
+		}
+		fprintf(out, "const unsigned char %sBitmaps[] PROGMEM = {", font->name);
+		for (size_t i = 0; i < size; i++) {
+			fprintf(out, "%s0x%02X%s", (i % 16) ? " " : "\n\t", bytes[i], (i + 1 < size) ? "," : "");
+		}
+		fprintf(out, "\n};\n\n");
+		fprintf(out, "const Glyph %sGlyphs[] PROGMEM = {", font->name);
+		for (uint8_t i = 0; i < font->count; i++) {
+			fprintf(out, "%s{ ", (i % 6) ? " " : "\n\t");
+			write_char(out, font->glyphs[i].code);
+			fprintf(out, ", %u, %u }%s", font->glyphs[i].width,
+				packed ? font->glyphs[i].packed_offset : font->glyphs[i].raw_offset, (i + 1 < font->count) ? "," : "");
+		}
+		fprintf(out, "\n};\n\n");
+		fprintf(out, "const Font %s PROGMEM = { %u, %u, %u, %d, %sGlyphs, %sBitmaps };\n", font->name, font->pages,
+			font->spacing, font->count, packed, font->name, font->name);
+	}
+	write_sprites(out);
+}
+
+int main(int argc, char **argv)
+{
+	FILE *in, *out;
+
+	if (argc != 4) {
+		fprintf(stderr, "usage: %s FONTS SPRITES OUTPUT\n", argv[0]);
+		return 2;
+	}
+	for (int i = 1; i < 3; i++) {
+		path = argv[i];
+		line_number = 0;
+		in = fopen(path, "r");
+		if (!in) {
+			perror(path);
+			return 1;
+		}
+		read_assets(in);
+		fclose(in);
+	}
+
+	out = fopen(argv[3], "w");
+	if (!out) {
+		perror(argv[3]);
+		return 1;
+	}
+	write_header(out);
+	if (fclose(out)) {
+		perror(argv[3]);
+		return 1;
+	}
+	for (uint8_t f = 0; f < font_count; f++) {
+		printf("%s: %u glyphs, %zu bytes, %zu packed%s\n", fonts[f].name, fonts[f].count, fonts[f].raw_size,
+			fonts[f].packed_size, is_packed(&fonts[f]) ? "" : ", stored unpacked");
+	}
+	for (uint8_t i = 0; i < sprite_count; i++) {
+		printf("%s: %u shift%s, %zu bytes, %zu packed\n", sprites[i].name, sprites[i].shifts,
+			(sprites[i].shifts > 1) ? "s" : "", sprites[i].raw_size, sprites[i].packed_size);
+	}
+	return 0;
+}
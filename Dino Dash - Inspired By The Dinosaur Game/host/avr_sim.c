@@ -0,0 +1,853 @@
+/*
+ * ATmega328P side of the host simulator
+ *
+ * Owns the register file, the simulated clock and the interrupt sources, and
+ * implements the parts of the hardware abstraction layer that main.c leaves to
+ * the host: the Fleury i2c_* master functions and the EEPROM access functions.
+ *
+ * Bus timing follows the TWI bit rate programmed into TWBR/TWSR: every byte
+ * costs nine SCL periods (eight data bits and the ACK), START and STOP one each.
+ * Above sim_config.max_scl_hz the panel no longer recognises its address, and
+ * before sim_config.panel_ready_ns it is still coming out of reset and ignores it.
+ *
+ * Timer0 raises its overflow interrupt and Timer1 its compare A interrupt in CTC
+ * mode, which is all the game programs them for. TCNT1 follows the simulated
+ * clock; the ISR always runs on time, so OCF1A never reads as pending. The ADC converts on its own when
+ * auto triggered by the Timer0 overflow, and raises its interrupt when done.
+ *
+ * The TWI can also be driven by its interrupt: every write to TWCR goes through
+ * sim_twi_command(), the operation runs on the bus while the firmware carries on,
+ * and TWINT is set with the datasheet status code once it is over.
+ *
+ * The UART transmitter takes a byte at a time at the baud rate in UBRR0 and
+ * raises USART_UDRE_vect when it can take the next one. Its bytes go to
+ * sim_config.uart_out.
+ *
+ * An EEPROM write takes 3.4 ms, started either by the avr-libc functions, which
+ * wait for the one before, or by sim_eeprom_write() from the firmware's own
+ * EE_READY_vect. EEPE stays set while a write runs and EE_READY_vect is raised
+ * whenever it is clear with EERIE set.
+ *
+ * The SLEEP instruction goes through sim_sleep(). Idle mode waits for the next
+ * interrupt like sim_idle(). Power-down stops the clocks, so the timers hold
+ * their count, and only a pin change on PCMSK2 wakes it: the joystick button
+ * (PD6) or a touch (PD3), after the crystal's start-up time. The time spent in
+ * each mode is kept in sim_power for the current estimate of dino_sim.
+ */
+#include <setjmp.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <avr/io.h>
+#include <avr/eeprom.h>
+#include <avr/sleep.h>
+#include <compat/twi.h>
+#include "sim.h"
+#include "../i2cmaster.h"
+
+#define SSD1306_ADDRESS 0x78
+
+/* ---- register file ---- */
+volatile uint8_t DDRC, PORTC, DDRD, PORTD;
+volatile uint8_t EICRA, EIMSK, EIFR;
+volatile uint8_t PCICR, PCIFR, PCMSK2;
+volatile uint8_t SMCR;
+volatile uint8_t TCNT0, TCCR0A, TCCR0B, TIMSK0;
+volatile uint8_t TCCR1A, TCCR1B, TIMSK1;
+volatile uint16_t TCNT1, OCR1A;
+volatile uint8_t TIFR1;
+volatile uint8_t TWSR, TWBR, TWCR, TWDR;
+volatile uint8_t ADMUX, ADCSRA, ADCSRB;
+volatile uint16_t ADCW;
+volatile uint16_t UBRR0;
+volatile uint8_t UCSR0A, UCSR0B, UCSR0C, UDR0;
+volatile uint8_t EECR, EEDR;
+volatile uint16_t EEAR;
+
+/* ---- interrupt vectors, main.c provides the ones it uses ---- */
+void __attribute__((weak)) TIMER0_OVF_vect(void) {}
+void __attribute__((weak)) INT1_vect(void) {}
+void __attribute__((weak)) PCINT2_vect(void) {}
+void __attribute__((weak)) TIMER1_COMPA_vect(void) {}
+void __attribute__((weak)) TWI_vect(void) {}
+void __attribute__((weak)) ADC_vect(void) {}
+void __attribute__((weak)) USART_UDRE_vect(void) {}
+void __attribute__((weak)) EE_READY_vect(void) {}
+
+int dino_main(void);
+
+uint64_t sim_now_ns;
+uint8_t sim_eeprom[SIM_EEPROM_SIZE];
+sim_config_t sim_config;
+sim_frame_t sim_current;
+sim_power_t sim_power;
+sim_frame_t *sim_frames;
+uint32_t sim_frame_count;
+
+static uint8_t interrupts_enabled;
+static uint64_t timer0_next_ns;
+static uint64_t timer1_next_ns;
+static uint8_t bus_open;		/* a START has been sent and no STOP yet */
+static uint8_t bus_to_panel;	/* the open transaction is addressed to the SSD1306 */
+static uint64_t twi_free_ns;	/* when the operation on the bus ends */
+static uint64_t twi_done_ns;	/* when TWINT is set next, 0 = no operation that sets it */
+static uint8_t twi_done_status;	/* status code TWSR takes when it is */
+static uint8_t twi_expect_address;	/* a START went out, TWDR holds SLA+R/W next */
+static uint64_t adc_done_ns;	/* when the running conversion ends, 0 = none running */
+static uint64_t uart_ready_ns;	/* when UDR0 takes the next byte, 0 = it already does */
+static uint64_t eeprom_ready_ns;	/* when the last EEPROM write is done */
+static uint64_t touch_next_ns;	/* when the touch sensor is touched next, 0 = never */
+static uint8_t pin_changed;		/* PCIF2, PCIFR itself only takes the firmware's writes */
+static uint32_t frames_allocated;
+static jmp_buf run_exit;
+
+/* ---- clock and interrupts ---- */
+
+void sim_sei(void)
+{
+	interrupts_enabled = 1;
+}
+
+void sim_cli(void)
+{
+	interrupts_enabled = 0;
+}
+
+static void call_isr(void (*vector)(void))
+{
+	uint8_t saved = interrupts_enabled;
+
+	/* The AVR clears the I flag on entry, RETI sets it again */
+	interrupts_enabled = 0;
+	vector();
+	interrupts_enabled = saved;
+}
+
+/* Timer0 and Timer1 share the same clock select encoding */
+static const uint16_t timer_prescale[8] = { 0, 1, 8, 64, 256, 1024, 0, 0 };
+
+static uint64_t timer0_period_ns(void)
+{
+	uint16_t prescale = timer_prescale[TCCR0B & 0x07];
+
+	return prescale ? 256ULL * prescale * 1000000000ULL / F_CPU : 0;
+}
+
+static uint64_t timer1_period_ns(void)
+{
+	uint16_t prescale = timer_prescale[TCCR1B & 0x07];
+
+	/* Only CTC on OCR1A is modelled */
+	if (!prescale || !(TCCR1B & (1 << WGM12))) {
+		return 0;
+	}
+	return (OCR1A + 1ULL) * prescale * 1000000000ULL / F_CPU;
+}
+
+/* TCNT1 counts up to OCR1A and clears on the compare match */
+static void timer1_count(void)
+{
+	uint64_t period = timer1_period_ns();
+	uint64_t step;
+	uint64_t left;
+
+	if (!period || !timer1_next_ns) {
+		return;
+	}
+	step = period / (OCR1A + 1ULL);
+	left = (timer1_next_ns > sim_now_ns) ? timer1_next_ns - sim_now_ns : 0;
+	TCNT1 = (left >= period) ? 0 : (uint16_t)((period - left) / step);
+}
+
+/* Arms a timer the first time it is seen running and reports whether its interrupt can fire */
+static int timer_due(uint64_t period, uint64_t *next, uint8_t enabled)
+{
+	if (!period) {
+		*next = 0;
+		return 0;
+	}
+	if (*next == 0) {
+		*next = sim_now_ns + period;
+	}
+	return interrupts_enabled && enabled;
+}
+
+/* INTF1 is set with the interrupt enabled, the vector clears it */
+static int int1_pending(void)
+{
+	return interrupts_enabled && (EIFR & (1 << INTF1)) && (EIMSK & (1 << INT1));
+}
+
+/* PCIF2 is set with the interrupt enabled, the vector clears it
+ * The firmware writes a one to PCIFR to clear the flag, which is taken here */
+static int pcint_pending(void)
+{
+	if (PCIFR & (1 << PCIF2)) {
+		PCIFR = 0;
+		pin_changed = 0;
+	}
+	return interrupts_enabled && pin_changed && (PCICR & (1 << PCIE2));
+}
+
+/* TWINT is set with the interrupt enabled: the TWI interrupt is level triggered */
+static int twi_pending(void)
+{
+	return interrupts_enabled && (TWCR & (1 << TWINT)) && (TWCR & (1 << TWIE));
+}
+
+/* ADIF is set with the interrupt enabled, the vector clears it */
+static int adc_pending(void)
+{
+	return interrupts_enabled && (ADCSRA & (1 << ADIF)) && (ADCSRA & (1 << ADIE));
+}
+
+/* UDRE0 is set with the interrupt enabled, the ISR has to write UDR0 or turn it off */
+static int uart_pending(void)
+{
+	return interrupts_enabled && (UCSR0A & (1 << UDRE0)) && (UCSR0B & (1 << UDRIE0));
+}
+
+/* No write running with the interrupt enabled, the ISR has to start one or turn it off */
+static int eeprom_pending(void)
+{
+	return interrupts_enabled && !(EECR & (1 << EEPE)) && (EECR & (1 << EERIE));
+}
+
+/* A Timer0 overflow starts a conversion when it is the auto trigger source */
+static void adc_trigger(void)
+{
+	uint8_t prescale = 1 << (ADCSRA & 0x07);
+
+	if ((ADCSRA & (1 << ADEN)) && (ADCSRA & (1 << ADATE)) && (ADCSRB & 0x07) == (1 << ADTS2) && !adc_done_ns) {
+		/* 13.5 ADC clocks for an auto triggered conversion */
+		adc_done_ns = sim_now_ns + 27ULL * (prescale < 2 ? 2 : prescale) * 1000000000ULL / F_CPU / 2;
+	}
+}
+
+static void stop_run(void)
+{
+	longjmp(run_exit, 1);
+}
+
+void sim_advance_ns(uint64_t ns)
+{
+	uint64_t target = sim_now_ns + ns;
+
+	while (1) {
+		uint64_t period0 = timer0_period_ns();
+		uint64_t period1 = timer1_period_ns();
+		int due0 = timer_due(period0, &timer0_next_ns, TIMSK0 & (1 << TOIE0)) && timer0_next_ns <= target;
+		int due1 = timer_due(period1, &timer1_next_ns, TIMSK1 & (1 << OCIE1A)) && timer1_next_ns <= target;
+		int due_twi = twi_done_ns && twi_done_ns <= target;
+		int due_adc = adc_done_ns && adc_done_ns <= target;
+		int due_uart = uart_ready_ns && uart_ready_ns <= target;
+		int due_eeprom = (EECR & (1 << EEPE)) && eeprom_ready_ns <= target;
+		int due_touch = touch_next_ns && touch_next_ns <= target;
+
+		/* In vector table order: INT1, PCINT2, USART_UDRE, ADC, EE_READY, TWI */
+		if (int1_pending()) {
+			EIFR &= ~(1 << INTF1);
+			call_isr(INT1_vect);
+			continue;
+		}
+		if (pcint_pending()) {
+			pin_changed = 0;
+			call_isr(PCINT2_vect);
+			continue;
+		}
+		if (uart_pending()) {
+			call_isr(USART_UDRE_vect);
+			continue;
+		}
+		if (adc_pending()) {
+			ADCSRA &= ~(1 << ADIF);
+			call_isr(ADC_vect);
+			continue;
+		}
+		if (eeprom_pending()) {
+			call_isr(EE_READY_vect);
+			continue;
+		}
+		if (twi_pending()) {
+			call_isr(TWI_vect);
+			continue;
+		}
+		if (!due0 && !due1 && !due_twi && !due_adc && !due_uart && !due_eeprom && !due_touch) {
+			break;
+		}
+		/* A touch before everything else is one rising edge on INT1 */
+		if (due_touch && (!due_uart || touch_next_ns < uart_ready_ns) && (!due_adc || touch_next_ns < adc_done_ns) &&
+			(!due_eeprom || touch_next_ns < eeprom_ready_ns) && (!due_twi || touch_next_ns < twi_done_ns) &&
+			(!due0 || touch_next_ns < timer0_next_ns) && (!due1 || touch_next_ns < timer1_next_ns)) {
+			sim_now_ns = touch_next_ns;
+			touch_next_ns += sim_config.touch_ns;
+			if ((EICRA & ((1 << ISC11) | (1 << ISC10))) == ((1 << ISC11) | (1 << ISC10))) {
+				EIFR |= (1 << INTF1);
+			}
+			ssd1306_tick(sim_now_ns);
+		}
+		/* The transmitter freeing UDR0 first */
+		else if (due_uart && (!due_adc || uart_ready_ns < adc_done_ns) && (!due_twi || uart_ready_ns < twi_done_ns) &&
+			(!due_eeprom || uart_ready_ns < eeprom_ready_ns) &&
+			(!due0 || uart_ready_ns < timer0_next_ns) && (!due1 || uart_ready_ns < timer1_next_ns)) {
+			sim_now_ns = uart_ready_ns;
+			uart_ready_ns = 0;
+			UCSR0A |= (1 << UDRE0);
+			ssd1306_tick(sim_now_ns);
+		}
+		/* A conversion finishing first hands its result over */
+		else if (due_adc && (!due_twi || adc_done_ns < twi_done_ns) && (!due_eeprom || adc_done_ns < eeprom_ready_ns) &&
+			(!due0 || adc_done_ns < timer0_next_ns) && (!due1 || adc_done_ns < timer1_next_ns)) {
+			sim_now_ns = adc_done_ns;
+			adc_done_ns = 0;
+			ADCW = (uint16_t)sim_read_adc(ADMUX & 0x0F);
+			ADCSRA |= (1 << ADIF);
+			ssd1306_tick(sim_now_ns);
+		}
+		/* An EEPROM write ending first clears EEPE */
+		else if (due_eeprom && (!due_twi || eeprom_ready_ns < twi_done_ns) && (!due0 || eeprom_ready_ns < timer0_next_ns) &&
+			(!due1 || eeprom_ready_ns < timer1_next_ns)) {
+			if (eeprom_ready_ns > sim_now_ns) {
+				sim_now_ns = eeprom_ready_ns;
+			}
+			EECR &= ~(1 << EEPE);
+			ssd1306_tick(sim_now_ns);
+		}
+		/* The bus finishes an operation before any timer event that is due later */
+		else if (due_twi && (!due0 || twi_done_ns < timer0_next_ns) && (!due1 || twi_done_ns < timer1_next_ns)) {
+			sim_now_ns = twi_done_ns;
+			twi_done_ns = 0;
+			TWSR = (TWSR & 0x07) | twi_done_status;
+			TWCR |= (1 << TWINT);
+			ssd1306_tick(sim_now_ns);
+		}
+		/* Earliest event first, Timer1 compare A has the higher priority on a tie */
+		else if (due1 && (!due0 || timer1_next_ns <= timer0_next_ns)) {
+			sim_now_ns = timer1_next_ns;
+			timer1_next_ns += period1;
+			ssd1306_tick(sim_now_ns);
+			call_isr(TIMER1_COMPA_vect);
+		}
+		else {
+			sim_now_ns = timer0_next_ns;
+			timer0_next_ns += period0;
+			ssd1306_tick(sim_now_ns);
+			adc_trigger();
+			call_isr(TIMER0_OVF_vect);
+		}
+		/* The ISR may have waited on its own, never move the clock backwards */
+		if (sim_now_ns > target) {
+			target = sim_now_ns;
+		}
+	}
+	sim_now_ns = target;
+	ssd1306_tick(sim_now_ns);
+	timer1_count();
+
+	if (sim_config.max_ns && sim_now_ns >= sim_config.max_ns) {
+		stop_run();
+	}
+}
+
+void sim_idle(void)
+{
+	uint64_t next = sim_now_ns + 1000;
+
+	/* Nothing but an interrupt ends the wait, so skip straight to the next timer event */
+	if (timer_due(timer1_period_ns(), &timer1_next_ns, TIMSK1 & (1 << OCIE1A))) {
+		next = timer1_next_ns;
+	}
+	if (timer_due(timer0_period_ns(), &timer0_next_ns, TIMSK0 & (1 << TOIE0)) && timer0_next_ns < next) {
+		next = timer0_next_ns;
+	}
+	if (twi_done_ns && twi_done_ns < next) {
+		next = twi_done_ns;
+	}
+	if (adc_done_ns && adc_done_ns < next) {
+		next = adc_done_ns;
+	}
+	if (uart_ready_ns && uart_ready_ns < next) {
+		next = uart_ready_ns;
+	}
+	if ((EECR & (1 << EEPE)) && eeprom_ready_ns < next) {
+		next = eeprom_ready_ns;
+	}
+	if (touch_next_ns && touch_next_ns < next) {
+		next = touch_next_ns;
+	}
+	if (int1_pending() || pcint_pending() || twi_pending() || adc_pending() || uart_pending() || eeprom_pending()) {
+		next = sim_now_ns;
+	}
+	if (next < sim_now_ns) {
+		next = sim_now_ns;
+	}
+	sim_current.idle_ns += next - sim_now_ns;
+	sim_power.idle_ns += next - sim_now_ns;
+	sim_advance_ns(next - sim_now_ns);
+}
+
+/* The next edge on a pin PCMSK2 watches, 0 = none comes */
+static uint64_t next_pin_change(void)
+{
+	uint64_t next = 0;
+
+	if (PCMSK2 & (1 << PCINT22)) {
+		if (sim_config.press_ns > sim_now_ns) {
+			next = sim_config.press_ns;
+		}
+		else if (sim_config.press_ns + SIM_PRESS_NS > sim_now_ns) {
+			next = sim_config.press_ns + SIM_PRESS_NS;
+		}
+	}
+	if ((PCMSK2 & (1 << PCINT19)) && touch_next_ns && (!next || touch_next_ns < next)) {
+		next = touch_next_ns;
+	}
+	return next;
+}
+
+void sim_sleep(void)
+{
+	uint64_t wake;
+
+	if (!(SMCR & (1 << SE))) {
+		sim_advance_ns(1000000000ULL / F_CPU);
+		return;
+	}
+	if ((SMCR & ((1 << SM0) | (1 << SM1) | (1 << SM2))) != SLEEP_MODE_PWR_DOWN) {
+		sim_idle();
+		return;
+	}
+	/* A pin change latched before the SLEEP ends it straight away */
+	if (pcint_pending()) {
+		sim_advance_ns(0);
+		return;
+	}
+	wake = (interrupts_enabled && (PCICR & (1 << PCIE2))) ? next_pin_change() : 0;
+	if (!wake || (sim_config.max_ns && wake >= sim_config.max_ns)) {
+		/* Nothing wakes it before the run is over */
+		wake = sim_config.max_ns ? sim_config.max_ns : sim_now_ns;
+		sim_power.power_down_ns += wake - sim_now_ns;
+		sim_now_ns = wake;
+		ssd1306_tick(sim_now_ns);
+		stop_run();
+	}
+	wake += SIM_WAKE_NS;
+	/* The clocks stop, so the timers carry on from where they were */
+	if (timer0_next_ns) {
+		timer0_next_ns += wake - sim_now_ns;
+	}
+	if (timer1_next_ns) {
+		timer1_next_ns += wake - sim_now_ns;
+	}
+	/* INT1 only sees edges with the I/O clock running, a touch while asleep is a pin change alone */
+	while (touch_next_ns && touch_next_ns <= wake) {
+		touch_next_ns += sim_config.touch_ns;
+	}
+	sim_power.power_down_ns += wake - sim_now_ns;
+	sim_now_ns = wake;
+	ssd1306_tick(sim_now_ns);
+	pin_changed = 1;
+	sim_advance_ns(0);
+}
+
+/* ---- TWI master ---- */
+
+uint32_t sim_scl_hz(void)
+{
+	static const uint8_t prescale[4] = { 1, 4, 16, 64 };
+
+	return (uint32_t)(F_CPU / (16 + 2UL * TWBR * prescale[TWSR & 0x03]));
+}
+
+static void bus_clocks(uint32_t scl_periods)
+{
+	uint64_t ns = scl_periods * 1000000000ULL / sim_scl_hz();
+
+	sim_current.bus_ns += ns;
+	sim_advance_ns(ns);
+}
+
+static void bus_close(void)
+{
+	if (bus_open && bus_to_panel) {
+		ssd1306_end();
+	}
+	bus_open = 0;
+	bus_to_panel = 0;
+}
+
+/* Whether the panel acknowledges an address byte sent now */
+static int panel_acks(uint8_t address)
+{
+	return ((address & 0xFE) == SSD1306_ADDRESS) && !(address & I2C_READ) && (sim_now_ns >= sim_config.panel_ready_ns)
+		&& (!sim_config.max_scl_hz || sim_scl_hz() <= sim_config.max_scl_hz);
+}
+
+unsigned char i2c_start(unsigned char address)
+{
+	/* A START while a transaction is open is a repeated START */
+	bus_close();
+	sim_current.transactions++;
+	sim_current.bus_bytes++;
+	bus_open = 1;
+	bus_to_panel = panel_acks(address);
+	if (bus_to_panel) {
+		ssd1306_begin();
+	}
+	bus_clocks(1 + 9);
+	return bus_to_panel ? 0 : 1;
+}
+
+unsigned char i2c_start_wait(unsigned char address)
+{
+	for (uint16_t tries = 0; tries < I2C_WAIT_TRIES; tries++) {
+		if (!i2c_start(address)) {
+			return 0;
+		}
+		i2c_stop();
+	}
+	return 1;
+}
+
+unsigned char i2c_rep_start(unsigned char address)
+{
+	return i2c_start(address);
+}
+
+void i2c_stop(void)
+{
+	bus_close();
+	bus_clocks(1);
+}
+
+unsigned char i2c_write(unsigned char data)
+{
+	/* The byte still goes out on the wire, but a slave only listens inside a transaction */
+	uint8_t delivered = bus_open && bus_to_panel;
+
+	sim_current.bus_bytes++;
+	if (delivered) {
+		ssd1306_byte(data);
+	}
+	bus_clocks(9);
+	return delivered ? 0 : 1;
+}
+
+unsigned char i2c_readAck(void)
+{
+	bus_clocks(9);
+	return 0xFF;
+}
+
+unsigned char i2c_readNak(void)
+{
+	bus_clocks(9);
+	return 0xFF;
+}
+
+/* ---- interrupt driven TWI ---- */
+
+void sim_twi_command(uint8_t bits)
+{
+	uint32_t scl_periods = 0;
+	uint8_t sets_twint = 1;
+
+	/* Writing a one clears TWINT, the STOP is over before the firmware can look at TWSTO */
+	TWCR = bits & ~((1 << TWINT) | (1 << TWSTO));
+	if (!(bits & (1 << TWINT)) || !(bits & (1 << TWEN))) {
+		return;
+	}
+	if (bits & (1 << TWSTO)) {
+		bus_close();
+		scl_periods += 1;
+	}
+	if (bits & (1 << TWSTA)) {
+		twi_done_status = bus_open ? TW_REP_START : TW_START;
+		bus_close();
+		bus_open = 1;
+		twi_expect_address = 1;
+		sim_current.transactions++;
+		scl_periods += 1;
+	}
+	else if (bus_open && twi_expect_address) {
+		twi_expect_address = 0;
+		bus_to_panel = panel_acks(TWDR);
+		if (bus_to_panel) {
+			ssd1306_begin();
+		}
+		twi_done_status = bus_to_panel ? TW_MT_SLA_ACK : TW_MT_SLA_NACK;
+		sim_current.bus_bytes++;
+		scl_periods += 9;
+	}
+	else if (bus_open) {
+		if (bus_to_panel) {
+			ssd1306_byte(TWDR);
+		}
+		twi_done_status = bus_to_panel ? TW_MT_DATA_ACK : TW_MT_DATA_NACK;
+		sim_current.bus_bytes++;
+		scl_periods += 9;
+	}
+	else {
+		/* A lone STOP leaves TWINT alone */
+		sets_twint = 0;
+	}
+
+	/* Operations queue up behind the one still on the wire */
+	uint64_t ns = scl_periods * 1000000000ULL / sim_scl_hz();
+	if (twi_free_ns < sim_now_ns) {
+		twi_free_ns = sim_now_ns;
+	}
+	twi_free_ns += ns;
+	sim_current.bus_ns += ns;
+	if (sets_twint) {
+		twi_done_ns = twi_free_ns;
+	}
+}
+
+/* ---- joystick ---- */
+
+uint8_t sim_read_pind(void)
+{
+	uint8_t pind = 0xFF;
+
+	/* A polling loop spends a few cycles per read */
+	sim_advance_ns(250);
+	if (sim_now_ns >= sim_config.press_ns && sim_now_ns < sim_config.press_ns + SIM_PRESS_NS) {
+		pind &= ~0x40;
+	}
+	/* The touch sensor drives PD3 high while it is touched */
+	if (!sim_config.record || sim_now_ns >= SIM_PRESS_NS) {
+		pind &= ~0x08;
+	}
+	return pind;
+}
+
+/* First column right of the T-Rex, ducking included, and the column its front reaches */
+#define LOOK_FROM 27
+#define REX_FRONT 23
+/* How far ahead the autopilot reacts, 15 ticks of travel at the game's 40 Hz */
+#define LEAD_NS 375000000ULL
+/* Most columns the obstacles move in one update, the fastest scroll rounded up */
+#define TORN_COLUMNS 3
+
+/* Leftmost lit column of a page in front of the T-Rex, -1 if there is none */
+static int leading_edge(uint8_t page)
+{
+	for (uint8_t x = LOOK_FROM; x < SIM_COLUMNS; x++) {
+		if (ssd1306.gddram[page][x]) {
+			return x;
+		}
+	}
+	return -1;
+}
+
+static uint8_t obstacle_in(uint8_t page, uint8_t from, uint8_t to)
+{
+	for (uint8_t x = from; x <= to; x++) {
+		if (ssd1306.gddram[page][x]) {
+			return 1;
+		}
+	}
+	return 0;
+}
+
+/* Whether the obstacle at column x reaches the front of the T-Rex within lead_ns */
+static int too_close(int x, uint64_t lead_ns, uint32_t columns_per_s)
+{
+	return x >= 0 && (uint64_t)(x - REX_FRONT) * 1000000000ULL <= lead_ns * columns_per_s;
+}
+
+static unsigned int autopilot(void)
+{
+	static uint8_t ducking;
+	static int first_edge = -1, last_edge = -1;
+	static uint64_t first_ns;
+	static uint32_t columns_per_s = 40;
+	int ground = leading_edge(6);
+	int low = leading_edge(5);
+	/* Conversions land while a frame is on the bus, so one page can still be a step behind the other */
+	int edge = (ground >= 0 && (low < 0 || ground <= low + TORN_COLUMNS)) ? ground : low;
+
+	/* The game speeds up, so time the nearest obstacle over the whole way it has come */
+	if (edge < 0 || last_edge < 0 || edge > last_edge) {
+		first_edge = edge;
+		first_ns = sim_now_ns;
+	}
+	else if (first_edge - edge >= 8 && sim_now_ns > first_ns) {
+		columns_per_s = (uint32_t)((first_edge - edge) * 1000000000ULL / (sim_now_ns - first_ns));
+	}
+	last_edge = edge;
+
+	/* Stay down until the pterodactyl has passed over the T-Rex */
+	if (ducking) {
+		ducking = obstacle_in(5, 0, LOOK_FROM) || too_close(low, LEAD_NS, columns_per_s);
+		return ducking ? SIM_STICK_DOWN : SIM_STICK_REST;
+	}
+	if (!too_close(edge, LEAD_NS, columns_per_s)) {
+		return SIM_STICK_REST;
+	}
+	/* Anything on the ground page is a cactus, jump it */
+	if (edge == ground) {
+		return SIM_STICK_UP;
+	}
+	/* Something only on the page above is a pterodactyl, duck under it */
+	ducking = 1;
+	return SIM_STICK_DOWN;
+}
+
+unsigned int sim_read_adc(unsigned char channel)
+{
+	(void)channel;
+	if (sim_config.autopilot_ns && sim_now_ns >= sim_config.autopilot_ns) {
+		return SIM_STICK_REST;
+	}
+	return sim_config.autopilot ? autopilot() : SIM_STICK_REST;
+}
+
+/* ---- UART ---- */
+
+/* Start bit, eight data bits and a stop bit at F_CPU / 16 / (UBRR0 + 1), or / 8 with U2X0 */
+static uint64_t uart_byte_ns(void)
+{
+	uint64_t divide = (UCSR0A & (1 << U2X0)) ? 8 : 16;
+
+	return 10 * divide * (UBRR0 + 1ULL) * 1000000000ULL / F_CPU;
+}
+
+void sim_uart_write(uint8_t byte)
+{
+	if (!(UCSR0B & (1 << TXEN0))) {
+		return;
+	}
+	UDR0 = byte;
+	UCSR0A &= ~(1 << UDRE0);
+	uart_ready_ns = ((uart_ready_ns > sim_now_ns) ? uart_ready_ns : sim_now_ns) + uart_byte_ns();
+	if (sim_config.uart_out) {
+		fputc(byte, sim_config.uart_out);
+	}
+}
+
+/* ---- EEPROM ---- */
+
+/* Every access waits for a write still in progress, as eeprom_busy_wait() does */
+static void eeprom_wait(void)
+{
+	if (sim_now_ns < eeprom_ready_ns) {
+		sim_advance_ns(eeprom_ready_ns - sim_now_ns);
+	}
+}
+
+void sim_eeprom_write(uint16_t address, uint8_t value)
+{
+	/* The part ignores EEPE while a write is running */
+	if (EECR & (1 << EEPE)) {
+		return;
+	}
+	EEAR = address;
+	EEDR = value;
+	sim_eeprom[address & E2END] = value;
+	EECR |= (1 << EEPE);
+	eeprom_ready_ns = sim_now_ns + SIM_EEPROM_WRITE_NS;
+}
+
+uint8_t eeprom_read_byte(const uint8_t *address)
+{
+	eeprom_wait();
+	return sim_eeprom[(uintptr_t)address & E2END];
+}
+
+uint16_t eeprom_read_word(const uint16_t *address)
+{
+	const uint8_t *low = (const uint8_t *)address;
+
+	return eeprom_read_byte(low) | (uint16_t)(eeprom_read_byte(low + 1) << 8);
+}
+
+void eeprom_write_byte(uint8_t *address, uint8_t value)
+{
+	eeprom_wait();
+	sim_eeprom_write((uint16_t)(uintptr_t)address, value);
+}
+
+void eeprom_write_word(uint16_t *address, uint16_t value)
+{
+	uint8_t *low = (uint8_t *)address;
+
+	eeprom_write_byte(low, (uint8_t)value);
+	eeprom_write_byte(low + 1, (uint8_t)(value >> 8));
+}
+
+/* ---- frames and run control ---- */
+
+void sim_frame_end(void)
+{
+	sim_current.frame = sim_frame_count;
+	sim_current.frame_ns = sim_now_ns - sim_current.start_ns;
+
+	if (sim_frame_count == frames_allocated) {
+		frames_allocated = frames_allocated ? frames_allocated * 2 : 1024;
+		sim_frames = realloc(sim_frames, frames_allocated * sizeof(*sim_frames));
+		if (!sim_frames) {
+			abort();
+		}
+	}
+	sim_frames[sim_frame_count++] = sim_current;
+
+	memset(&sim_current, 0, sizeof(sim_current));
+	sim_current.start_ns = sim_now_ns;
+
+	if (sim_config.max_frames && sim_frame_count >= sim_config.max_frames) {
+		stop_run();
+	}
+}
+
+void sim_reset(void)
+{
+	DDRC = PORTC = DDRD = PORTD = 0;
+	EICRA = EIMSK = EIFR = 0;
+	PCICR = PCIFR = PCMSK2 = 0;
+	SMCR = 0;
+	TCNT0 = TCCR0A = TCCR0B = TIMSK0 = 0;
+	TCCR1A = TCCR1B = TIMSK1 = 0;
+	TCNT1 = OCR1A = 0;
+	TIFR1 = 0;
+	UBRR0 = 0;
+	UCSR0A = (1 << UDRE0);
+	UCSR0B = UCSR0C = UDR0 = 0;
+	TWSR = TWBR = TWCR = TWDR = 0;
+	ADMUX = ADCSRA = ADCSRB = 0;
+	ADCW = 0;
+
+	sim_now_ns = 0;
+	interrupts_enabled = 0;
+	timer0_next_ns = 0;
+	timer1_next_ns = 0;
+	bus_open = bus_to_panel = 0;
+	twi_free_ns = twi_done_ns = 0;
+	twi_done_status = twi_expect_address = 0;
+	adc_done_ns = 0;
+	uart_ready_ns = 0;
+	eeprom_ready_ns = 0;
+	touch_next_ns = 0;
+	pin_changed = 0;
+	memset(&sim_power, 0, sizeof(sim_power));
+	EECR = EEDR = 0;
+	EEAR = 0;
+	memset(sim_eeprom, 0xFF, sizeof(sim_eeprom));
+
+	free(sim_frames);
+	sim_frames = NULL;
+	sim_frame_count = frames_allocated = 0;
+	memset(&sim_current, 0, sizeof(sim_current));
+
+	ssd1306_reset();
+}
+
+uint32_t sim_run(void)
+{
+	touch_next_ns = sim_config.touch_ns;
+	if (setjmp(run_exit) == 0) {
+		dino_main();
+	}
+	return sim_frame_count;
+}
@@ -0,0 +1,592 @@
+/*
+ * Benchmarks for Dino Dash against the simulated ATmega328P and SSD1306
+ *
+ * Measures what the drawing primitives of main.c and whole game sessions cost
+ * on the bus: bytes clocked out, START conditions, bytes that reached GDDRAM or
+ * the command decoder, SCL busy time and simulated wall time. The numbers come
+ * from the simulator's clock, so they are the same on every host.
+ *
+ * A primitive is measured from a known screen: the bench draws what comes
+ * before it, waits for the bus to go quiet, then calls it and flushes the
+ * framebuffer. The T-Rex keyframes are measured as the step from the keyframe
+ * before them, which is what the game sends when it animates. Sessions are
+ * measured per frame: an autopilot run, a recorded game and its replay, and
+ * any EEPROM recording given with --session (dino_sim --record makes one).
+ * The replay has to end on the frame and the score the recorded game did.
+ *
+ * main.c keeps its state in globals that only power on resets, so every
+ * benchmark runs in a child process of its own.
+ *
+ * Results are printed as JSON. --compare reads a baseline written by an earlier
+ * run and fails when a cost grew by more than the threshold.
+ *
+ *   dino_bench [--max-scl HZ] [--frames N] [--session FILE]... [--out FILE]
+ *              [--compare FILE] [--threshold PCT]
+ */
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/wait.h>
+
+#include <avr/interrupt.h>
+#include <avr/pgmspace.h>
+
+#include "sim.h"
+#include "i2cmaster.h"
+
+/* The parts of main.c the benchmarks call, it has no header of its own */
+extern uint8_t rexMode;
+extern uint8_t scoreDigits[];
+extern uint8_t frameBuffer[8][128];
+extern uint8_t dirtyStart[8];
+extern uint8_t dirtyEnd[8];
+void oled_init();
+void flush();
+void clearTopTwoPages();
+void drawRex();
+void renderPlayfield();
+void background();
+void scrollLeft();
+void initObstacles();
+void gameStart();
+typedef struct Font Font;
+extern const Font FontLarge;
+uint8_t drawText(uint8_t x, uint8_t page, const Font *font, const char *text);
+void drawScore();
+void scorePoint();
+uint16_t scoreBCD();
+void Timer0Settings();
+void Timer1Settings();
+
+#define NAME_SIZE 48
+#define MAX_RESULTS 128
+#define MAX_SESSIONS 16
+#define KEYFRAMES 29
+#define FIRST_DUCK 25			/* Keyframes 25 to 28 are the ducking sprites */
+#define SESSION_SECONDS 600		/* a recorded game is played out well before this */
+#define PRESS_NS 2000000000ULL	/* the button leaves the title two seconds after power on, as in dino_sim */
+#define RECORD_NS 30000000000ULL	/* the recorded game is steered this long, then runs into an obstacle */
+
+typedef struct {
+	char name[NAME_SIZE];
+	uint32_t frames;		/* 0 for a primitive, the figures below are then for one call */
+	double bytes;			/* bus bytes, per frame for a session */
+	double transactions;
+	double data_bytes;
+	double cmd_bytes;
+	double bus_us;
+	double time_us;
+	uint16_t score;			/* final score of a session, BCD, not compared */
+} result_t;
+
+/* The costs --compare checks, a larger value is always worse */
+static const struct {
+	const char *key;
+	size_t offset;
+} metrics[] = {
+	{ "bytes", offsetof(result_t, bytes) },
+	{ "transactions", offsetof(result_t, transactions) },
+	{ "data_bytes", offsetof(result_t, data_bytes) },
+	{ "cmd_bytes", offsetof(result_t, cmd_bytes) },
+	{ "bus_us", offsetof(result_t, bus_us) },
+	{ "time_us", offsetof(result_t, time_us) },
+};
+#define METRICS (sizeof(metrics) / sizeof(metrics[0]))
+
+static double metric(const result_t *r, size_t m)
+{
+	return *(const double *)((const char *)r + metrics[m].offset);
+}
+
+static result_t results[MAX_RESULTS];
+static size_t result_count;
+
+static uint32_t max_scl = 400000;
+static uint32_t session_frames = 2000;
+static int output_fd = -1;			/* the pipe a benchmark child reports through */
+static FILE *recording;				/* EEPROM image of the recorded session, shared with the children */
+
+static void usage(const char *argv0)
+{
+	fprintf(stderr,
+		"usage: %s [--max-scl HZ] [--frames N] [--session FILE]... [--out FILE]\n"
+		"          [--compare FILE] [--threshold PCT]\n"
+		"  --max-scl HZ     fastest SCL the panel acknowledges (default 400000, 0 = any)\n"
+		"  --frames N       length of the autopilot session (default 2000)\n"
+		"  --session FILE   also replay this EEPROM recording (dino_sim --record)\n"
+		"  --out FILE       write the JSON there instead of standard output\n"
+		"  --compare FILE   check the results against a baseline written by --out\n"
+		"  --threshold PCT  growth --compare accepts before it reports a regression (default 5)\n",
+		argv0);
+}
+
+/* ---- running a benchmark ---- */
+
+static void emit(const result_t *r)
+{
+	if (write(output_fd, r, sizeof(*r)) != (ssize_t)sizeof(*r)) {
+		_exit(1);
+	}
+}
+
+/* Runs one benchmark in a fresh process and collects what it emits */
+static int run(void (*bench)(const void *), const void *arg)
+{
+	int fds[2];
+	pid_t child;
+	int status;
+	result_t r;
+
+	fflush(NULL);
+	if (pipe(fds) || (child = fork()) < 0) {
+		perror("dino_bench");
+		return -1;
+	}
+	if (child == 0) {
+		close(fds[0]);
+		output_fd = fds[1];
+		bench(arg);
+		_exit(0);
+	}
+	close(fds[1]);
+	while (read(fds[0], &r, sizeof(r)) == (ssize_t)sizeof(r)) {
+		if (result_count < MAX_RESULTS) {
+			results[result_count++] = r;
+		}
+	}
+	close(fds[0]);
+	if (waitpid(child, &status, 0) < 0 || !WIFEXITED(status) || WEXITSTATUS(status)) {
+		fprintf(stderr, "dino_bench: a benchmark child failed\n");
+		return -1;
+	}
+	return 0;
+}
+
+/* ---- primitives ---- */
+
+static sim_frame_t mark;
+static uint64_t mark_ns;
+
+/* Blanks the whole panel, every column is sent whatever the framebuffer held */
+static void clear_display(void)
+{
+	memset(frameBuffer, 0, sizeof(frameBuffer));
+	memset(dirtyStart, 0, sizeof(dirtyStart));
+	memset(dirtyEnd, 127, sizeof(dirtyEnd));
+	flush();
+}
+
+/* Powers the MCU up the way main() does, up to setting up the panel */
+static void power_on(void)
+{
+	sim_reset();
+	sim_config.max_scl_hz = max_scl;
+	i2c_init();
+	sei();
+}
+
+/* Powers the panel up the way main() does, without the game */
+static void boot(void)
+{
+	power_on();
+	oled_init();
+	clear_display();
+}
+
+static void begin(void)
+{
+	flush();
+	mark = sim_current;
+	mark_ns = sim_now_ns;
+}
+
+static void end(const char *name)
+{
+	result_t r;
+
+	flush();
+	memset(&r, 0, sizeof(r));
+	snprintf(r.name, sizeof(r.name), "%s", name);
+	r.bytes = sim_current.bus_bytes - mark.bus_bytes;
+	r.transactions = sim_current.transactions - mark.transactions;
+	r.data_bytes = sim_current.data_bytes - mark.data_bytes;
+	r.cmd_bytes = sim_current.cmd_bytes - mark.cmd_bytes;
+	r.bus_us = (sim_current.bus_ns - mark.bus_ns) / 1e3;
+	r.time_us = (sim_now_ns - mark_ns) / 1e3;
+	emit(&r);
+}
+
+static void bench_screens(const void *arg)
+{
+	power_on();
+	begin();
+	oled_init();
+	end("oled_init");
+
+	clear_display();
+	begin();
+	drawRex();
+	end("drawRex");
+
+	clear_display();
+	begin();
+	drawText(0, 0, &FontLarge, PSTR("P"));
+	end("drawText");
+
+	clear_display();
+	begin();
+	gameStart();
+	end("gameStart");
+
+	begin();
+	clearTopTwoPages();
+	end("clearTopTwoPages");
+
+	gameStart();
+	background();
+	drawRex();
+	begin();
+	clear_display();
+	end("flush_full_panel");
+}
+
+/* The game steps 0 -> 1 -> ... -> 24 and back down through a jump, 0 -> 25 -> ... -> 28 into a duck */
+static void bench_keyframes(const void *arg)
+{
+	char name[NAME_SIZE];
+
+	boot();
+	initObstacles();
+	for (uint8_t mode = 0; mode < KEYFRAMES; mode++) {
+		uint8_t from = (mode == 0) ? 1 : ((mode == FIRST_DUCK) ? 0 : mode - 1);
+
+		rexMode = from;
+		renderPlayfield();
+		begin();
+		rexMode = mode;
+		renderPlayfield();
+		if (mode == 0) {
+			snprintf(name, sizeof(name), "standing");
+		}
+		else if (mode < FIRST_DUCK) {
+			snprintf(name, sizeof(name), "jumping%u", mode);
+		}
+		else {
+			snprintf(name, sizeof(name), "ducking%u", mode - FIRST_DUCK + 1);
+		}
+		end(name);
+	}
+}
+
+/* One digit, then 0999 -> 1000 where every digit changes */
+static void bench_score(const void *arg)
+{
+	boot();
+	drawScore();
+	for (int i = 0; i < 999; i++) {
+		scorePoint();
+	}
+	begin();
+	scorePoint();
+	end("scorePoint_carry");
+	begin();
+	scorePoint();
+	end("scorePoint");
+}
+
+/* ---- frames and sessions ---- */
+
+static void emit_frames(const char *name, uint32_t first)
+{
+	result_t r;
+	uint64_t bus_ns = 0, frame_ns = 0;
+
+	memset(&r, 0, sizeof(r));
+	snprintf(r.name, sizeof(r.name), "%s", name);
+	for (uint32_t i = first; i < sim_frame_count; i++) {
+		const sim_frame_t *f = &sim_frames[i];
+		r.bytes += f->bus_bytes;
+		r.transactions += f->transactions;
+		r.data_bytes += f->data_bytes;
+		r.cmd_bytes += f->cmd_bytes;
+		bus_ns += f->bus_ns;
+		frame_ns += f->frame_ns;
+	}
+	r.frames = sim_frame_count - first;
+	if (r.frames) {
+		r.bytes /= r.frames;
+		r.transactions /= r.frames;
+		r.data_bytes /= r.frames;
+		r.cmd_bytes /= r.frames;
+		r.bus_us = bus_ns / 1e3 / r.frames;
+		r.time_us = frame_ns / 1e3 / r.frames;
+	}
+	r.score = scoreBCD();
+	emit(&r);
+}
+
+/* The game running with the joystick at rest, the first frame carries the setup and is left out */
+static void bench_scroll(const void *arg)
+{
+	boot();
+	Timer0Settings();
+	Timer1Settings();
+	initObstacles();
+	background();
+	scrollLeft();
+	for (int i = 0; i < 200; i++) {
+		scrollLeft();
+	}
+	emit_frames("scrollLeft", 1);
+}
+
+static void bench_autopilot(const void *arg)
+{
+	sim_reset();
+	sim_config.max_frames = session_frames;
+	sim_config.max_scl_hz = max_scl;
+	sim_config.press_ns = PRESS_NS;
+	sim_config.autopilot = 1;
+	sim_run();
+	emit_frames("session_autopilot", 0);
+}
+
+/* Plays a game on the autopilot, lets it run into an obstacle and keeps the recording it made for
+   the replay */
+static void bench_record(const void *arg)
+{
+	sim_reset();
+	sim_config.max_ns = SESSION_SECONDS * 1000000000ULL;
+	sim_config.max_scl_hz = max_scl;
+	sim_config.press_ns = PRESS_NS;
+	sim_config.autopilot = 1;
+	sim_config.autopilot_ns = PRESS_NS + RECORD_NS;
+	sim_config.record = 1;
+	sim_run();
+	emit_frames("session_recorded", 0);
+	if (fwrite(sim_eeprom, 1, SIM_EEPROM_SIZE, recording) != SIM_EEPROM_SIZE || fflush(recording)) {
+		_exit(1);
+	}
+}
+
+/* arg is the EEPROM image to play back, then the result name */
+static void bench_replay(const void *arg)
+{
+	const uint8_t *image = arg;
+
+	sim_reset();
+	memcpy(sim_eeprom, image, SIM_EEPROM_SIZE);
+	sim_config.max_ns = SESSION_SECONDS * 1000000000ULL;
+	sim_config.max_scl_hz = max_scl;
+	sim_config.press_ns = 0;
+	sim_config.autopilot = 0;
+	sim_run();
+	emit_frames((const char *)(image + SIM_EEPROM_SIZE), 0);
+}
+
+static int load_session(const char *path, uint8_t *image)
+{
+	FILE *f = fopen(path, "rb");
+	const char *base = strrchr(path, '/');
+
+	if (!f) {
+		perror(path);
+		return -1;
+	}
+	size_t done = fread(image, 1, SIM_EEPROM_SIZE, f);
+	fclose(f);
+	if (done != SIM_EEPROM_SIZE) {
+		fprintf(stderr, "%s: not a %u byte EEPROM image\n", path, SIM_EEPROM_SIZE);
+		return -1;
+	}
+	snprintf((char *)image + SIM_EEPROM_SIZE, NAME_SIZE, "session:%s", base ? base + 1 : path);
+	return 0;
+}
+
+/* ---- output and comparison ---- */
+
+static void print_json(FILE *out)
+{
+	fprintf(out, "{\n  \"max_scl_hz\": %u,\n  \"results\": [\n", max_scl);
+	for (size_t i = 0; i < result_count; i++) {
+		const result_t *r = &results[i];
+		fprintf(out, "    {\"name\": \"%s\", \"frames\": %u", r->name, r->frames);
+		for (size_t m = 0; m < METRICS; m++) {
+			fprintf(out, ", \"%s\": %.3f", metrics[m].key, metric(r, m));
+		}
+		fprintf(out, "}%s\n", (i + 1 < result_count) ? "," : "");
+	}
+	fprintf(out, "  ]\n}\n");
+}
+
+/* Reads the value of "key" on a line of our own JSON, returns 0 if it is not there */
+static int json_number(const char *line, const char *key, double *value)
+{
+	char pattern[NAME_SIZE];
+	const char *at;
+
+	snprintf(pattern, sizeof(pattern), "\"%s\": ", key);
+	at = strstr(line, pattern);
+	if (!at) {
+		return 0;
+	}
+	*value = strtod(at + strlen(pattern), NULL);
+	return 1;
+}
+
+static const result_t *find(const char *name)
+{
+	for (size_t i = 0; i < result_count; i++) {
+		if (!strcmp(results[i].name, name)) {
+			return &results[i];
+		}
+	}
+	return NULL;
+}
+
+/* Returns the number of regressions, or -1 if the baseline cannot be read */
+static int compare(const char *path, double threshold)
+{
+	FILE *f = fopen(path, "r");
+	char line[512];
+	int regressions = 0, checked = 0;
+	double scl;
+
+	if (!f) {
+		perror(path);
+		return -1;
+	}
+	while (fgets(line, sizeof(line), f)) {
+		char name[NAME_SIZE];
+		const char *at = strstr(line, "\"name\": \"");
+
+		if (json_number(line, "max_scl_hz", &scl) && (uint32_t)scl != max_scl) {
+			fprintf(stderr, "warning: baseline was taken with --max-scl %u\n", (uint32_t)scl);
+		}
+		if (!at || sscanf(at + 9, "%47[^\"]", name) != 1) {
+			continue;
+		}
+		const result_t *now = find(name);
+		if (!now) {
+			fprintf(stderr, "%-20s missing from this run\n", name);
+			regressions++;
+			continue;
+		}
+		checked++;
+		for (size_t m = 0; m < METRICS; m++) {
+			double before;
+			if (!json_number(line, metrics[m].key, &before)) {
+				continue;
+			}
+			double after = metric(now, m);
+			if (after > before * (1.0 + threshold / 100.0) + 0.0005) {
+				fprintf(stderr, "%-20s %-12s %10.3f -> %10.3f  (+%.1f%%)\n", name, metrics[m].key, before, after,
+					before > 0 ? (after / before - 1.0) * 100.0 : 100.0);
+				regressions++;
+			}
+		}
+	}
+	fclose(f);
+	if (!checked) {
+		fprintf(stderr, "%s: no results found\n", path);
+		return -1;
+	}
+	fprintf(stderr, "%d results checked against %s, %d regressions over %.1f%%\n", checked, path, regressions,
+		threshold);
+	return regressions;
+}
+
+int main(int argc, char **argv)
+{
+	static uint8_t sessions[MAX_SESSIONS][SIM_EEPROM_SIZE + NAME_SIZE];
+	static uint8_t recorded[SIM_EEPROM_SIZE + NAME_SIZE];
+	size_t session_count = 0;
+	const char *out_path = NULL;
+	const char *baseline = NULL;
+	double threshold = 5.0;
+	int failed = 0;
+
+	for (int i = 1; i < argc; i++) {
+		if (!strcmp(argv[i], "--max-scl") && i + 1 < argc) {
+			max_scl = (uint32_t)strtoul(argv[++i], NULL, 0);
+		}
+		else if (!strcmp(argv[i], "--frames") && i + 1 < argc) {
+			session_frames = (uint32_t)strtoul(argv[++i], NULL, 0);
+		}
+		else if (!strcmp(argv[i], "--session") && i + 1 < argc && session_count < MAX_SESSIONS) {
+			if (load_session(argv[++i], sessions[session_count++])) {
+				return 1;
+			}
+		}
+		else if (!strcmp(argv[i], "--out") && i + 1 < argc) {
+			out_path = argv[++i];
+		}
+		else if (!strcmp(argv[i], "--compare") && i + 1 < argc) {
+			baseline = argv[++i];
+		}
+		else if (!strcmp(argv[i], "--threshold") && i + 1 < argc) {
+			threshold = strtod(argv[++i], NULL);
+		}
+		else {
+			usage(argv[0]);
+			return 2;
+		}
+	}
+
+	recording = tmpfile();
+	if (!recording) {
+		perror("dino_bench");
+		return 1;
+	}
+
+	failed |= run(bench_screens, NULL);
+	failed |= run(bench_keyframes, NULL);
+	failed |= run(bench_score, NULL);
+	failed |= run(bench_scroll, NULL);
+	failed |= run(bench_autopilot, NULL);
+	failed |= run(bench_record, NULL);
+	rewind(recording);
+	if (!failed && fread(recorded, 1, SIM_EEPROM_SIZE, recording) == SIM_EEPROM_SIZE) {
+		snprintf((char *)recorded + SIM_EEPROM_SIZE, NAME_SIZE, "session_replayed");
+		failed |= run(bench_replay, recorded);
+	}
+	fclose(recording);
+	if (!failed) {
+		const result_t *game = find("session_recorded");
+		const result_t *replay = find("session_replayed");
+		if (!game || !replay || game->frames != replay->frames || game->score != replay->score) {
+			fprintf(stderr, "dino_bench: the replay ended at frame %u with score %04x, the game at frame %u with %04x\n",
+				replay ? replay->frames : 0, replay ? replay->score : 0, game ? game->frames : 0, game ? game->score : 0);
+			failed = 1;
+		}
+	}
+	for (size_t i = 0; i < session_count; i++) {
+		failed |= run(bench_replay, sessions[i]);
+	}
+	if (failed) {
+		return 1;
+	}
+
+	if (out_path) {
+		FILE *out = fopen(out_path, "w");
+		if (!out) {
+			perror(out_path);
+			return 1;
+		}
+		print_json(out);
+		fclose(out);
+	}
+	else {
+		print_json(stdout);
+	}
+
+	if (baseline) {
+		int regressions = compare(baseline, threshold);
+		if (regressions) {
+			return 1;
+		}
+	}
+	return 0;
+}
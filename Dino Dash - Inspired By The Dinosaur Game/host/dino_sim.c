@@ -0,0 +1,297 @@
+/*
+ * Headless runner for Dino Dash
+ *
+ * Boots main.c against the simulated ATmega328P and SSD1306, plays with the
+ * autopilot and reports how many bus bytes, transactions and how much SCL time
+ * every frame cost.
+ *
+ * --record holds the touch sensor through power on, which has the game record
+ * its first game to EEPROM, and saves that image once the run is over; --replay
+ * loads one and holds the button through power on, which plays the recorded
+ * game back step for step with the autopilot off.
+ * --eeprom keeps the EEPROM in a file across runs, like a board that is powered
+ * off and on again, so the high score table carries over.
+ *
+ * --touch-ms touches the sensor over and over, which starts a new game every
+ * time one has ended; the autopilot plays all of them.
+ *
+ * --telemetry saves what the game sends on its UART during the run; built with
+ * TELEMETRY=1 that is one binary record per frame, which telemetry decodes.
+ *
+ * Every run ends with the share of time the MCU spent active, idle and powered
+ * down, how long the panel was lit, and a lower bound on the average supply
+ * current that makes. Game logic and drawing take no simulated time, so the
+ * CPU time they cost on the board is counted as idle.
+ *
+ * Built with PROFILE=1, --profile prints the game's own phase timings for the
+ * last frames through its UART dump once the run is over.
+ *
+ *   dino_sim [--frames N] [--seconds S] [--press-ms MS] [--touch-ms MS] [--no-autopilot]
+ *            [--max-scl HZ] [--panel-ms MS] [--record FILE] [--replay FILE] [--eeprom FILE] [--telemetry FILE] [--profile]
+ *            [--csv] [--screen]
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "sim.h"
+
+/* Ticks of the last game that were stepped without being drawn and display transfers the panel
+ * did not acknowledge, main.c has no header */
+extern uint16_t skippedFrames;
+extern volatile uint16_t twiErrors;
+
+#ifdef PROFILE
+void profileDump(void);
+#endif
+
+/* Supply currents for the lower bound: the ATmega328P at 16 MHz and 5 V from the typical curves
+ * of its datasheet, brown-out detection left on, and a mostly dark 128x64 SSD1306 module */
+#define MCU_ACTIVE_MA 9.0
+#define MCU_IDLE_MA 2.5
+#define MCU_POWER_DOWN_MA 0.02
+#define PANEL_ON_MA 8.0
+#define PANEL_OFF_MA 0.01
+
+static void usage(const char *argv0)
+{
+	fprintf(stderr,
+		"usage: %s [--frames N] [--seconds S] [--press-ms MS] [--touch-ms MS] [--no-autopilot] [--max-scl HZ]\n"
+		"          [--panel-ms MS] [--record FILE] [--replay FILE] [--eeprom FILE] [--telemetry FILE] [--profile] [--csv] [--screen]\n"
+		"  --frames N      stop after N frames (default 600)\n"
+		"  --seconds S     stop after S seconds of simulated time (default 120)\n"
+		"  --press-ms MS   push the joystick button MS after power on (default 2000)\n"
+		"  --touch-ms MS   touch the sensor every MS, each touch after a game starts the next (default never)\n"
+		"  --no-autopilot  leave the joystick at rest\n"
+		"  --max-scl HZ    fastest SCL the panel acknowledges (default 400000, 0 = any)\n"
+		"  --panel-ms MS   the panel ignores its address for MS after power on (default 0)\n"
+		"  --record FILE   record the first game and save the EEPROM with it when the run ends\n"
+		"  --replay FILE   load the EEPROM from FILE and play its game back\n"
+		"  --eeprom FILE   load the EEPROM from FILE if it exists and save it there when the run ends\n"
+		"  --telemetry FILE save the UART output of the run (make TELEMETRY=1)\n"
+		"  --profile       print the game's profile dump (make PROFILE=1)\n"
+		"  --csv           print one line per frame\n"
+		"  --screen        print the panel contents when the run ends\n",
+		argv0);
+}
+
+/* The EEPROM image is stored raw, byte 0 first */
+static int eeprom_file(const char *path, int save)
+{
+	FILE *f = fopen(path, save ? "wb" : "rb");
+	size_t done;
+
+	if (!f) {
+		perror(path);
+		return -1;
+	}
+	if (save) {
+		done = fwrite(sim_eeprom, 1, SIM_EEPROM_SIZE, f);
+	}
+	else {
+		done = fread(sim_eeprom, 1, SIM_EEPROM_SIZE, f);
+	}
+	fclose(f);
+	if (done != SIM_EEPROM_SIZE) {
+		fprintf(stderr, "%s: not a %u byte EEPROM image\n", path, SIM_EEPROM_SIZE);
+		return -1;
+	}
+	return 0;
+}
+
+static void print_screen(void)
+{
+	for (uint8_t y = 0; y < SIM_PAGES * 8; y++) {
+		char line[SIM_COLUMNS + 1];
+		for (uint8_t x = 0; x < SIM_COLUMNS; x++) {
+			line[x] = ssd1306_pixel(x, y) ? '#' : '.';
+		}
+		line[SIM_COLUMNS] = '\0';
+		printf("%s\n", line);
+	}
+}
+
+int main(int argc, char **argv)
+{
+	uint32_t frames = 600;
+	double seconds = 120.0;
+	double press_ms = 2000.0;
+	double touch_ms = 0.0;
+	double panel_ms = 0.0;
+	int autopilot = 1;
+	uint32_t max_scl = 400000;
+	int csv = 0;
+	int screen = 0;
+	const char *record = NULL;
+	const char *replay = NULL;
+	const char *eeprom = NULL;
+	const char *telemetry = NULL;
+#ifdef PROFILE
+	int profile = 0;
+#endif
+
+	for (int i = 1; i < argc; i++) {
+		if (!strcmp(argv[i], "--frames") && i + 1 < argc) {
+			frames = (uint32_t)strtoul(argv[++i], NULL, 0);
+		}
+		else if (!strcmp(argv[i], "--seconds") && i + 1 < argc) {
+			seconds = strtod(argv[++i], NULL);
+		}
+		else if (!strcmp(argv[i], "--press-ms") && i + 1 < argc) {
+			press_ms = strtod(argv[++i], NULL);
+		}
+		else if (!strcmp(argv[i], "--touch-ms") && i + 1 < argc) {
+			touch_ms = strtod(argv[++i], NULL);
+		}
+		else if (!strcmp(argv[i], "--no-autopilot")) {
+			autopilot = 0;
+		}
+		else if (!strcmp(argv[i], "--panel-ms") && i + 1 < argc) {
+			panel_ms = strtod(argv[++i], NULL);
+		}
+		else if (!strcmp(argv[i], "--max-scl") && i + 1 < argc) {
+			max_scl = (uint32_t)strtoul(argv[++i], NULL, 0);
+		}
+		else if (!strcmp(argv[i], "--record") && i + 1 < argc) {
+			record = argv[++i];
+		}
+		else if (!strcmp(argv[i], "--replay") && i + 1 < argc) {
+			replay = argv[++i];
+		}
+		else if (!strcmp(argv[i], "--eeprom") && i + 1 < argc) {
+			eeprom = argv[++i];
+		}
+		else if (!strcmp(argv[i], "--telemetry") && i + 1 < argc) {
+			telemetry = argv[++i];
+		}
+		else if (!strcmp(argv[i], "--profile")) {
+#ifdef PROFILE
+			profile = 1;
+#else
+			fprintf(stderr, "%s: built without PROFILE, rebuild with make clean all PROFILE=1\n", argv[0]);
+			return 2;
+#endif
+		}
+		else if (!strcmp(argv[i], "--csv")) {
+			csv = 1;
+		}
+		else if (!strcmp(argv[i], "--screen")) {
+			screen = 1;
+		}
+		else {
+			usage(argv[0]);
+			return 2;
+		}
+	}
+
+	sim_reset();
+	sim_config.max_frames = frames;
+	sim_config.max_ns = (uint64_t)(seconds * 1e9);
+	sim_config.press_ns = (uint64_t)(press_ms * 1e6);
+	sim_config.touch_ns = (uint64_t)(touch_ms * 1e6);
+	sim_config.autopilot = autopilot;
+	sim_config.max_scl_hz = max_scl;
+	sim_config.panel_ready_ns = (uint64_t)(panel_ms * 1e6);
+	sim_config.record = record != NULL;
+	if (eeprom) {
+		FILE *f = fopen(eeprom, "rb");
+		if (f) {
+			fclose(f);
+			if (eeprom_file(eeprom, 0)) {
+				return 1;
+			}
+		}
+	}
+	if (replay) {
+		if (eeprom_file(replay, 0)) {
+			return 1;
+		}
+		sim_config.press_ns = 0;
+		sim_config.autopilot = 0;
+	}
+
+	if (telemetry) {
+		sim_config.uart_out = fopen(telemetry, "wb");
+		if (!sim_config.uart_out) {
+			perror(telemetry);
+			return 1;
+		}
+	}
+
+	uint32_t count = sim_run();
+
+	if (sim_config.uart_out) {
+		fclose(sim_config.uart_out);
+		sim_config.uart_out = NULL;
+	}
+
+	if (record && eeprom_file(record, 1)) {
+		return 1;
+	}
+	if (eeprom && eeprom_file(eeprom, 1)) {
+		return 1;
+	}
+
+	if (csv) {
+		printf("frame,start_ms,frame_ms,bus_ms,idle_ms,bus_bytes,transactions,data_bytes,cmd_bytes\n");
+		for (uint32_t i = 0; i < count; i++) {
+			const sim_frame_t *f = &sim_frames[i];
+			printf("%u,%.3f,%.3f,%.3f,%.3f,%u,%u,%u,%u\n", f->frame, f->start_ns / 1e6, f->frame_ns / 1e6,
+				f->bus_ns / 1e6, f->idle_ns / 1e6, f->bus_bytes, f->transactions, f->data_bytes, f->cmd_bytes);
+		}
+	}
+
+	if (count) {
+		uint64_t total_ns = 0, bus_ns = 0, idle_ns = 0, bytes = 0, transactions = 0;
+		uint32_t min_bytes = UINT32_MAX, max_bytes = 0;
+		for (uint32_t i = 0; i < count; i++) {
+			const sim_frame_t *f = &sim_frames[i];
+			total_ns += f->frame_ns;
+			bus_ns += f->bus_ns;
+			idle_ns += f->idle_ns;
+			bytes += f->bus_bytes;
+			transactions += f->transactions;
+			if (f->bus_bytes < min_bytes) min_bytes = f->bus_bytes;
+			if (f->bus_bytes > max_bytes) max_bytes = f->bus_bytes;
+		}
+		fprintf(stderr, "frames            %u\n", count);
+		fprintf(stderr, "simulated time    %.3f s\n", sim_now_ns / 1e9);
+		fprintf(stderr, "SCL               %u Hz\n", sim_scl_hz());
+		fprintf(stderr, "bytes / frame     avg %.1f  min %u  max %u\n", (double)bytes / count, min_bytes, max_bytes);
+		fprintf(stderr, "transactions / fr %.1f\n", (double)transactions / count);
+		fprintf(stderr, "bus time / frame  %.3f ms\n", bus_ns / 1e6 / count);
+		fprintf(stderr, "idle / frame      %.3f ms\n", idle_ns / 1e6 / count);
+		fprintf(stderr, "frame time        %.3f ms (%.1f fps)\n", total_ns / 1e6 / count, count * 1e9 / total_ns);
+		fprintf(stderr, "skipped frames    %u in the last game\n", skippedFrames);
+		fprintf(stderr, "dropped transfers %u\n", twiErrors);
+	}
+	else {
+		fprintf(stderr, "no frames completed in %.3f s\n", sim_now_ns / 1e9);
+	}
+
+	if (sim_now_ns) {
+		double total = (double)sim_now_ns;
+		double idle = sim_power.idle_ns / total;
+		double down = sim_power.power_down_ns / total;
+		double lit = sim_power.panel_on_ns / total;
+		double active = 1.0 - idle - down;
+		fprintf(stderr, "MCU               active %.1f%%  idle %.1f%%  power-down %.1f%%  (busy waits only)\n",
+			active * 100, idle * 100, down * 100);
+		fprintf(stderr, "panel lit         %.1f%%\n", lit * 100);
+		fprintf(stderr, "average current   >= %.2f mA (game logic and drawing not counted)\n", active * MCU_ACTIVE_MA + idle * MCU_IDLE_MA +
+			down * MCU_POWER_DOWN_MA + lit * PANEL_ON_MA + (1.0 - lit) * PANEL_OFF_MA);
+	}
+
+	if (screen) {
+		print_screen();
+	}
+#ifdef PROFILE
+	if (profile) {
+		sim_config.uart_out = stdout;
+		profileDump();
+		/* The tail of the dump is still in the game's UART ring, 10 ms sends all of it */
+		sim_advance_ns(10000000);
+	}
+#endif
+	return 0;
+}
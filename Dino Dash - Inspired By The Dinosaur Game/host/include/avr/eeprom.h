@@ -0,0 +1,18 @@
+/*
+ * Host stand-in for <avr/eeprom.h>
+ * The 1 KB EEPROM is an array in avr_sim.c. A write takes as long as on the part and
+ * the next access waits for it, like the avr-libc functions do.
+ */
+#ifndef HOST_AVR_EEPROM_H
+#define HOST_AVR_EEPROM_H
+
+#include <stdint.h>
+
+#define E2END 0x3FF
+
+uint8_t eeprom_read_byte(const uint8_t *address);
+uint16_t eeprom_read_word(const uint16_t *address);
+void eeprom_write_byte(uint8_t *address, uint8_t value);
+void eeprom_write_word(uint16_t *address, uint16_t value);
+
+#endif
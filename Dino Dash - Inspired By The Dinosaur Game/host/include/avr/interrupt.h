@@ -0,0 +1,15 @@
+/*
+ * Host stand-in for <avr/interrupt.h>
+ * ISRs become ordinary functions that the simulator calls when their event is due.
+ */
+#ifndef HOST_AVR_INTERRUPT_H
+#define HOST_AVR_INTERRUPT_H
+
+void sim_sei(void);
+void sim_cli(void);
+
+#define ISR(vector, ...) void vector(void)
+#define sei() sim_sei()
+#define cli() sim_cli()
+
+#endif
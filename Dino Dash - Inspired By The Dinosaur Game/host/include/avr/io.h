@@ -0,0 +1,112 @@
+/*
+ * Host stand-in for <avr/io.h>
+ * Every ATmega328P register the game touches is a plain variable owned by avr_sim.c.
+ * Registers whose reads have side effects on the board (PIND) go through the simulator.
+ */
+#ifndef HOST_AVR_IO_H
+#define HOST_AVR_IO_H
+
+#include <stdint.h>
+
+extern volatile uint8_t DDRC, PORTC, DDRD, PORTD;
+extern volatile uint8_t EICRA, EIMSK, EIFR;
+extern volatile uint8_t PCICR, PCIFR, PCMSK2;
+extern volatile uint8_t SMCR;
+extern volatile uint8_t TCNT0, TCCR0A, TCCR0B, TIMSK0;
+extern volatile uint8_t TCCR1A, TCCR1B, TIMSK1;
+extern volatile uint16_t TCNT1, OCR1A;
+extern volatile uint8_t TIFR1;
+extern volatile uint8_t TWSR, TWBR, TWCR, TWDR;
+extern volatile uint8_t ADMUX, ADCSRA, ADCSRB;
+extern volatile uint16_t ADCW;
+extern volatile uint16_t UBRR0;
+extern volatile uint8_t UCSR0A, UCSR0B, UCSR0C, UDR0;
+extern volatile uint8_t EECR, EEDR;
+extern volatile uint16_t EEAR;
+
+uint8_t sim_read_pind(void);
+#define PIND (sim_read_pind())
+
+/* EICRA / EIMSK / EIFR */
+#define ISC00 0
+#define ISC01 1
+#define ISC10 2
+#define ISC11 3
+#define INT0 0
+#define INT1 1
+#define INTF0 0
+#define INTF1 1
+
+/* PCICR / PCIFR / PCMSK2 */
+#define PCIE2 2
+#define PCIF2 2
+#define PCINT19 3
+#define PCINT22 6
+
+/* SMCR */
+#define SE 0
+#define SM0 1
+#define SM1 2
+#define SM2 3
+
+/* TCCR0B / TIMSK0 */
+#define CS00 0
+#define CS01 1
+#define CS02 2
+#define TOIE0 0
+
+/* TCCR1B / TIMSK1 */
+#define CS10 0
+#define CS11 1
+#define CS12 2
+#define WGM12 3
+#define WGM13 4
+#define TOIE1 0
+#define OCIE1A 1
+#define OCIE1B 2
+#define OCF1A 1
+
+/* TWCR / TWSR */
+#define TWIE 0
+#define TWEN 2
+#define TWWC 3
+#define TWSTO 4
+#define TWSTA 5
+#define TWEA 6
+#define TWINT 7
+#define TWPS0 0
+#define TWPS1 1
+
+/* ADMUX / ADCSRA / ADCSRB */
+#define REFS1 7
+#define REFS0 6
+#define ADLAR 5
+#define ADEN 7
+#define ADSC 6
+#define ADATE 5
+#define ADIF 4
+#define ADIE 3
+#define ADPS2 2
+#define ADPS1 1
+#define ADPS0 0
+#define ADTS2 2
+#define ADTS1 1
+#define ADTS0 0
+
+/* UCSR0A / UCSR0B / UCSR0C */
+#define RXC0 7
+#define UDRE0 5
+#define U2X0 1
+#define UDRIE0 5
+#define RXEN0 4
+#define TXEN0 3
+#define UCSZ01 2
+#define UCSZ00 1
+
+/* EECR */
+#define EERE 0
+#define EEPE 1
+#define EEMPE 2
+#define EERIE 3
+
+#endif
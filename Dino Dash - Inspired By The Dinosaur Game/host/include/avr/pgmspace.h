@@ -0,0 +1,21 @@
+/*
+ * Host stand-in for <avr/pgmspace.h>
+ * Flash and RAM share one address space on the host.
+ */
+#ifndef HOST_AVR_PGMSPACE_H
+#define HOST_AVR_PGMSPACE_H
+
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+#define PROGMEM
+#define PSTR(s) (s)
+#define pgm_read_byte(addr) (*(const uint8_t *)(addr))
+#define pgm_read_word(addr) (*(const uint16_t *)(addr))
+#define pgm_read_ptr(addr) (*(void * const *)(addr))
+#define memcpy_P(dest, src, n) memcpy((dest), (src), (n))
+#define strcpy_P(dest, src) strcpy((dest), (src))
+#define snprintf_P snprintf
+
+#endif
@@ -0,0 +1,9 @@
+/*
+ * Host stand-in for <avr/sfr_defs.h>
+ */
+#ifndef HOST_AVR_SFR_DEFS_H
+#define HOST_AVR_SFR_DEFS_H
+
+#define _BV(bit) (1 << (bit))
+
+#endif
@@ -0,0 +1,22 @@
+/*
+ * Host stand-in for <avr/sleep.h>
+ * SMCR is a plain register; the SLEEP instruction hands the wait to the simulator,
+ * which runs the clock to whatever wakes the sleep mode SMCR selects.
+ */
+#ifndef HOST_AVR_SLEEP_H
+#define HOST_AVR_SLEEP_H
+
+#include <avr/io.h>
+
+void sim_sleep(void);
+
+#define SLEEP_MODE_IDLE (0)
+#define SLEEP_MODE_PWR_DOWN (1 << SM1)
+
+#define set_sleep_mode(mode) (SMCR = (SMCR & ~((1 << SM0) | (1 << SM1) | (1 << SM2))) | (mode))
+#define sleep_enable() (SMCR |= (1 << SE))
+#define sleep_disable() (SMCR &= ~(1 << SE))
+#define sleep_cpu() sim_sleep()
+#define sleep_mode() do { sleep_enable(); sleep_cpu(); sleep_disable(); } while (0)
+
+#endif
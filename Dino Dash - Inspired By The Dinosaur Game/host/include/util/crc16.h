@@ -0,0 +1,20 @@
+/*
+ * Host stand-in for <util/crc16.h>
+ * Only the CRC the game uses, written out the way the avr-libc documentation gives it.
+ */
+#ifndef HOST_UTIL_CRC16_H
+#define HOST_UTIL_CRC16_H
+
+#include <stdint.h>
+
+/* CRC-8-CCITT, polynomial x^8 + x^2 + x + 1, no reflection */
+static inline uint8_t _crc8_ccitt_update(uint8_t crc, uint8_t data)
+{
+	crc ^= data;
+	for (uint8_t i = 0; i < 8; i++) {
+		crc = (crc & 0x80) ? (uint8_t)((crc << 1) ^ 0x07) : (uint8_t)(crc << 1);
+	}
+	return crc;
+}
+
+#endif
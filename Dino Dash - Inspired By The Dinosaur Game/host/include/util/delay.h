@@ -0,0 +1,17 @@
+/*
+ * Host stand-in for <util/delay.h>
+ * Busy waits advance the simulated clock instead of burning host time.
+ */
+#ifndef HOST_UTIL_DELAY_H
+#define HOST_UTIL_DELAY_H
+
+#include <stdint.h>
+
+void sim_advance_ns(uint64_t ns);
+
+#define _delay_ms(ms) sim_advance_ns((uint64_t)((ms) * 1000000.0))
+#define _delay_us(us) sim_advance_ns((uint64_t)((us) * 1000.0))
+/* Four CPU cycles per iteration, as in avr-libc */
+#define _delay_loop_2(count) sim_advance_ns((uint64_t)(count) * 4000000000ULL / F_CPU)
+
+#endif
@@ -0,0 +1,146 @@
+/*
+ * Dino Dash host simulator
+ *
+ * Stands in for the ATmega328P and the SSD1306 so main.c can run headless on Linux.
+ *   avr_sim.c      clock model, register file, interrupts, TWI master, joystick, UART, EEPROM
+ *   ssd1306_sim.c  controller model: command decoder, addressing, GDDRAM, scrolling
+ *   dino_sim.c     command line runner that prints per frame bus statistics
+ *   dino_bench.c   benchmarks for the drawing primitives and whole sessions, JSON out
+ *
+ * Time only moves when the firmware waits (delays, I2C transfers, polling), so the
+ * numbers reported are the bus and wait time of a frame, not host CPU time.
+ */
+#ifndef SIM_H
+#define SIM_H
+
+#include <stdint.h>
+#include <stdio.h>
+
+#define SIM_COLUMNS 128
+#define SIM_PAGES 8
+
+/* Counters for one frame, closed by sim_frame_end() */
+typedef struct {
+	uint32_t frame;
+	uint64_t start_ns;
+	uint64_t frame_ns;		/* simulated wall time of the frame */
+	uint64_t bus_ns;		/* time SCL was busy */
+	uint64_t idle_ns;		/* time spent waiting for the next game tick */
+	uint32_t bus_bytes;		/* every byte clocked out, including address bytes */
+	uint32_t transactions;	/* START conditions */
+	uint32_t data_bytes;	/* bytes that reached GDDRAM */
+	uint32_t cmd_bytes;		/* command and command argument bytes */
+} sim_frame_t;
+
+/* ---- clock and interrupts (avr_sim.c) ---- */
+extern uint64_t sim_now_ns;
+void sim_advance_ns(uint64_t ns);
+void sim_sei(void);
+void sim_cli(void);
+/* Called while the firmware waits for an interrupt */
+void sim_idle(void);
+/* The SLEEP instruction, in the mode SMCR selects */
+void sim_sleep(void);
+/* Crystal start-up after power-down, 16K clocks */
+#define SIM_WAKE_NS (16384ULL * 1000000000ULL / F_CPU)
+
+/* ---- power (avr_sim.c, ssd1306_sim.c) ---- */
+/* Time in each supply state since reset, the MCU is active for the rest */
+typedef struct {
+	uint64_t idle_ns;		/* MCU in idle mode or waiting in sim_idle() */
+	uint64_t power_down_ns;	/* MCU powered down, every clock stopped */
+	uint64_t panel_on_ns;	/* panel lit with its charge pump running */
+} sim_power_t;
+
+extern sim_power_t sim_power;
+
+/* ---- TWI bus (avr_sim.c) ---- */
+uint32_t sim_scl_hz(void);
+/* A write to TWCR: starts the START, byte or STOP it asks for on the interrupt driven bus */
+void sim_twi_command(uint8_t bits);
+
+/* ---- joystick (avr_sim.c) ---- */
+/* ADC value the joystick reports at rest, tilted up and tilted down */
+#define SIM_STICK_REST 512
+#define SIM_STICK_UP 100
+#define SIM_STICK_DOWN 900
+/* How long the button is held for at sim_config.press_ns, and the touch sensor at power on */
+#define SIM_PRESS_NS 150000000ULL
+uint8_t sim_read_pind(void);
+/* Sampled when a conversion ends, steered by the autopilot */
+unsigned int sim_read_adc(unsigned char channel);
+
+/* ---- UART (avr_sim.c) ---- */
+/* A byte written to UDR0 */
+void sim_uart_write(uint8_t byte);
+
+/* ---- EEPROM (avr_sim.c) ---- */
+#define SIM_EEPROM_SIZE 1024
+#define SIM_EEPROM_WRITE_NS 3400000ULL	/* erase and write of one byte */
+/* Erased at reset, load a recording into it before sim_run() to play one back */
+extern uint8_t sim_eeprom[SIM_EEPROM_SIZE];
+/* The EEMPE/EEPE write sequence: starts a write unless one is still running */
+void sim_eeprom_write(uint16_t address, uint8_t value);
+
+/* ---- run control (avr_sim.c) ---- */
+typedef struct {
+	uint32_t max_frames;	/* stop after this many frames, 0 = no limit */
+	uint64_t max_ns;		/* stop after this much simulated time, 0 = no limit */
+	uint64_t press_ns;		/* when the joystick button is pushed to leave the title */
+	uint64_t touch_ns;		/* the touch sensor is touched this often, 0 = never */
+	int autopilot;			/* steer the joystick from what is on the panel */
+	uint64_t autopilot_ns;	/* the autopilot lets go of the joystick then, 0 = never */
+	int record;				/* hold the touch sensor through power on, which records the first game */
+	uint32_t max_scl_hz;	/* fastest SCL the panel follows, it NACKs its address above this */
+	uint64_t panel_ready_ns;	/* the panel NACKs its address until then, coming out of reset */
+	FILE *uart_out;			/* where UART output goes, NULL drops it */
+} sim_config_t;
+
+extern sim_config_t sim_config;
+extern sim_frame_t sim_current;
+extern sim_frame_t *sim_frames;
+extern uint32_t sim_frame_count;
+
+void sim_reset(void);
+void sim_frame_end(void);
+/* Runs the firmware until a limit in sim_config is hit, returns the frames recorded */
+uint32_t sim_run(void);
+
+/* ---- SSD1306 (ssd1306_sim.c) ---- */
+typedef struct {
+	uint8_t gddram[SIM_PAGES][SIM_COLUMNS];
+	uint8_t display_on;
+	uint8_t charge_pump;
+	uint8_t addressing_mode;	/* 0 horizontal, 1 vertical, 2 page */
+	uint8_t column, page;
+	uint8_t column_start, column_end;
+	uint8_t page_start, page_end;
+	/* command decoder */
+	uint8_t cmd[8];
+	uint8_t cmd_len, cmd_need;
+	/* scrolling */
+	uint8_t scroll_active;
+	uint8_t scroll_left;
+	uint8_t scroll_page_start, scroll_page_end;
+	uint8_t scroll_interval;	/* frames per column step */
+	uint64_t scroll_next_ns;
+	uint32_t scroll_steps;
+	/* settings used by the frame clock */
+	uint8_t clock_div;
+	uint8_t precharge;
+	uint8_t multiplex;
+} ssd1306_t;
+
+extern ssd1306_t ssd1306;
+
+void ssd1306_reset(void);
+/* One I2C write transaction addressed to the panel, control bytes included */
+void ssd1306_begin(void);
+void ssd1306_byte(uint8_t byte);
+void ssd1306_end(void);
+/* Lets the panel run its own clock (hardware scrolling) up to time now_ns */
+void ssd1306_tick(uint64_t now_ns);
+uint64_t ssd1306_frame_ns(void);
+int ssd1306_pixel(uint8_t x, uint8_t y);
+
+#endif
@@ -0,0 +1,233 @@
+/*
+ * SSD1306 controller model
+ *
+ * Decodes the I2C write stream the way the controller does: a control byte
+ * (Co, D/C#) followed by commands or GDDRAM data. Covers what Dino Dash uses:
+ * page/column addressing in all three addressing modes, the 0x21/0x22 window,
+ * continuous horizontal scrolling (0x26/0x27, 0x2E/0x2F) and the panel settings
+ * that decide its frame rate. Command arguments may be split across
+ * transactions, just like on the real part.
+ */
+#include <string.h>
+
+#include "sim.h"
+
+#define FOSC_HZ 370000ULL	/* typical internal oscillator with 0xD5 upper nibble = 8 */
+
+ssd1306_t ssd1306;
+
+/* Per transaction decoder state */
+static uint8_t expect_control;	/* next byte is a control byte */
+static uint8_t stream;			/* Co = 0: everything that follows has the same D/C# */
+static uint8_t single_left;		/* Co = 1: bytes left before the next control byte */
+static uint8_t is_data;
+static uint64_t last_tick_ns;	/* how far the panel clock has run */
+
+void ssd1306_reset(void)
+{
+	memset(&ssd1306, 0, sizeof(ssd1306));
+	ssd1306.addressing_mode = 2;
+	ssd1306.column_end = SIM_COLUMNS - 1;
+	ssd1306.page_end = SIM_PAGES - 1;
+	ssd1306.clock_div = 0x80;
+	ssd1306.precharge = 0x22;
+	ssd1306.multiplex = 63;
+	ssd1306.scroll_interval = 5;
+	last_tick_ns = 0;
+}
+
+uint64_t ssd1306_frame_ns(void)
+{
+	uint64_t divide = (ssd1306.clock_div & 0x0F) + 1;
+	uint64_t clocks = (ssd1306.precharge & 0x0F) + (ssd1306.precharge >> 4) + 50;
+	uint64_t mux = ssd1306.multiplex + 1;
+
+	return divide * clocks * mux * 1000000000ULL / FOSC_HZ;
+}
+
+/* Scroll step interval in frames, indexed by the 3 bit code of 0x26/0x27 */
+static const uint16_t scroll_frames[8] = { 5, 64, 128, 256, 3, 4, 25, 2 };
+
+static void scroll_step(void)
+{
+	for (uint8_t page = ssd1306.scroll_page_start; page <= ssd1306.scroll_page_end && page < SIM_PAGES; page++) {
+		uint8_t *row = ssd1306.gddram[page];
+		if (ssd1306.scroll_left) {
+			uint8_t first = row[0];
+			memmove(row, row + 1, SIM_COLUMNS - 1);
+			row[SIM_COLUMNS - 1] = first;
+		}
+		else {
+			uint8_t last = row[SIM_COLUMNS - 1];
+			memmove(row + 1, row, SIM_COLUMNS - 1);
+			row[0] = last;
+		}
+	}
+	ssd1306.scroll_steps++;
+}
+
+void ssd1306_tick(uint64_t now_ns)
+{
+	if (now_ns > last_tick_ns) {
+		if (ssd1306.display_on && ssd1306.charge_pump) {
+			sim_power.panel_on_ns += now_ns - last_tick_ns;
+		}
+		last_tick_ns = now_ns;
+	}
+	while (ssd1306.scroll_active && now_ns >= ssd1306.scroll_next_ns) {
+		scroll_step();
+		ssd1306.scroll_next_ns += ssd1306.scroll_interval * ssd1306_frame_ns();
+	}
+}
+
+/* Number of argument bytes that follow a command opcode */
+static uint8_t command_arguments(uint8_t op)
+{
+	switch (op) {
+		case 0x20: case 0x81: case 0x8D: case 0xA8: case 0xD3:
+		case 0xD5: case 0xD8: case 0xD9: case 0xDA: case 0xDB:
+			return 1;
+		case 0x21: case 0x22: case 0xA3:
+			return 2;
+		case 0x29: case 0x2A:
+			return 5;
+		case 0x26: case 0x27:
+			return 6;
+		default:
+			return 0;
+	}
+}
+
+static void execute(const uint8_t *c)
+{
+	uint8_t op = c[0];
+
+	if (op <= 0x0F) {
+		ssd1306.column = (ssd1306.column & 0xF0) | op;
+	}
+	else if (op <= 0x1F) {
+		ssd1306.column = (uint8_t)(((op & 0x0F) << 4) | (ssd1306.column & 0x0F)) & 0x7F;
+	}
+	else if (op >= 0xB0 && op <= 0xB7) {
+		ssd1306.page = op & 0x07;
+	}
+	else {
+		switch (op) {
+			case 0x20: ssd1306.addressing_mode = c[1] & 0x03; break;
+			case 0x21:
+				ssd1306.column_start = c[1] & 0x7F;
+				ssd1306.column_end = c[2] & 0x7F;
+				ssd1306.column = ssd1306.column_start;
+				break;
+			case 0x22:
+				ssd1306.page_start = c[1] & 0x07;
+				ssd1306.page_end = c[2] & 0x07;
+				ssd1306.page = ssd1306.page_start;
+				break;
+			case 0x26: case 0x27:
+				if (!ssd1306.scroll_active) {
+					ssd1306.scroll_left = (op == 0x27);
+					ssd1306.scroll_page_start = c[2] & 0x07;
+					ssd1306.scroll_interval = (uint8_t)scroll_frames[c[3] & 0x07];
+					ssd1306.scroll_page_end = c[4] & 0x07;
+				}
+				break;
+			case 0x2E: ssd1306.scroll_active = 0; break;
+			case 0x2F:
+				if (!ssd1306.scroll_active) {
+					/* The first step lands on the next panel frame, the frame clock is free running */
+					uint64_t frame = ssd1306_frame_ns();
+					ssd1306.scroll_active = 1;
+					ssd1306.scroll_next_ns = (sim_now_ns / frame + 1) * frame;
+				}
+				break;
+			case 0x8D: ssd1306.charge_pump = (c[1] & 0x04) != 0; break;
+			case 0xA8: ssd1306.multiplex = c[1] & 0x3F; break;
+			case 0xAE: ssd1306.display_on = 0; break;
+			case 0xAF: ssd1306.display_on = 1; break;
+			case 0xD5: ssd1306.clock_div = c[1]; break;
+			case 0xD9: ssd1306.precharge = c[1]; break;
+			default: break;	/* contrast, remap, COM pins, ... do not change GDDRAM */
+		}
+	}
+}
+
+static void command_byte(uint8_t byte)
+{
+	sim_current.cmd_bytes++;
+	if (ssd1306.cmd_len == 0) {
+		ssd1306.cmd_need = command_arguments(byte);
+	}
+	ssd1306.cmd[ssd1306.cmd_len++] = byte;
+	if (ssd1306.cmd_len > ssd1306.cmd_need) {
+		execute(ssd1306.cmd);
+		ssd1306.cmd_len = 0;
+	}
+}
+
+static void data_byte(uint8_t byte)
+{
+	sim_current.data_bytes++;
+	ssd1306.gddram[ssd1306.page][ssd1306.column] = byte;
+
+	switch (ssd1306.addressing_mode) {
+		case 0:	/* horizontal */
+			if (ssd1306.column >= ssd1306.column_end) {
+				ssd1306.column = ssd1306.column_start;
+				ssd1306.page = (ssd1306.page >= ssd1306.page_end) ? ssd1306.page_start : ssd1306.page + 1;
+			}
+			else {
+				ssd1306.column++;
+			}
+			break;
+		case 1:	/* vertical */
+			if (ssd1306.page >= ssd1306.page_end) {
+				ssd1306.page = ssd1306.page_start;
+				ssd1306.column = (ssd1306.column >= ssd1306.column_end) ? ssd1306.column_start : ssd1306.column + 1;
+			}
+			else {
+				ssd1306.page++;
+			}
+			break;
+		default:	/* page */
+			ssd1306.column = (ssd1306.column + 1) & 0x7F;
+			break;
+	}
+}
+
+void ssd1306_begin(void)
+{
+	expect_control = 1;
+	stream = 0;
+	single_left = 0;
+}
+
+void ssd1306_byte(uint8_t byte)
+{
+	if (expect_control) {
+		expect_control = 0;
+		is_data = (byte & 0x40) != 0;
+		stream = (byte & 0x80) == 0;
+		single_left = 1;
+		return;
+	}
+	if (is_data) {
+		data_byte(byte);
+	}
+	else {
+		command_byte(byte);
+	}
+	if (!stream && --single_left == 0) {
+		expect_control = 1;
+	}
+}
+
+void ssd1306_end(void)
+{
+	expect_control = 1;
+}
+
+int ssd1306_pixel(uint8_t x, uint8_t y)
+{
+	return (ssd1306.gddram[y >> 3][x] >> (y & 7)) & 1;
+}
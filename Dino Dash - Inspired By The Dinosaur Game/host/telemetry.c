@@ -0,0 +1,199 @@
+/*
+ * Decoder for the telemetry Dino Dash sends on its UART when built with TELEMETRY
+ *
+ * Reads a capture of the serial line (from the board, or dino_sim --telemetry),
+ * finds the records by their sync byte and checksum, and prints them as CSV or
+ * as a text plot of the frame time over the run.
+ *
+ *   telemetry [--plot] [FILE]
+ */
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define SYNC 0xA5
+#define RECORD 13
+#define COUNT_US 16			/* Timer 1 runs at 16 MHz / 256 */
+#define TICK_US 25000		/* one game tick at 40 Hz */
+#define PLOT_ROWS 40
+#define PLOT_WIDTH 60
+#define PLOT_TICKS 4		/* the plot spans four ticks, slower frames run off its end */
+
+typedef struct {
+	uint16_t tick;
+	uint16_t frame_counts;
+	uint16_t bus_bytes;
+	uint8_t obstacles;
+	uint8_t rex_mode;
+	uint16_t score;
+	uint8_t dropped;
+} record_t;
+
+static record_t *records;
+static size_t count, allocated;
+
+static void usage(const char *argv0)
+{
+	fprintf(stderr,
+		"usage: %s [--plot] [FILE]\n"
+		"  --plot  draw the frame time over the run instead of printing CSV\n"
+		"  FILE    the capture, standard input if missing\n",
+		argv0);
+}
+
+static void add(const uint8_t *r)
+{
+	record_t *out;
+
+	if (count == allocated) {
+		allocated = allocated ? allocated * 2 : 1024;
+		records = realloc(records, allocated * sizeof(*records));
+		if (!records) {
+			abort();
+		}
+	}
+	out = &records[count++];
+	out->tick = r[1] | (r[2] << 8);
+	out->frame_counts = r[3] | (r[4] << 8);
+	out->bus_bytes = r[5] | (r[6] << 8);
+	out->obstacles = r[7];
+	out->rex_mode = r[8];
+	/* Four BCD digits, thousands in the top nibble */
+	out->score = (r[10] >> 4) * 1000 + (r[10] & 0x0F) * 100 + (r[9] >> 4) * 10 + (r[9] & 0x0F);
+	out->dropped = r[11];
+}
+
+/* Returns the bytes that did not belong to any record */
+static size_t decode(FILE *in)
+{
+	uint8_t window[RECORD];
+	size_t have = 0, skipped = 0;
+	int c;
+
+	while ((c = fgetc(in)) != EOF) {
+		window[have++] = (uint8_t)c;
+		while (have > 0 && window[0] != SYNC) {
+			memmove(window, window + 1, --have);
+			skipped++;
+		}
+		if (have < RECORD) {
+			continue;
+		}
+		uint8_t sum = 0;
+		for (int i = 1; i < RECORD - 1; i++) {
+			sum += window[i];
+		}
+		if (sum == window[RECORD - 1]) {
+			add(window);
+			have = 0;
+		}
+		else {
+			/* Not a record after all, look for the next sync byte */
+			memmove(window, window + 1, --have);
+			skipped++;
+		}
+	}
+	return skipped + have;
+}
+
+static double frame_ms(const record_t *r)
+{
+	return r->frame_counts * COUNT_US / 1000.0;
+}
+
+static void print_csv(void)
+{
+	printf("tick,frame_ms,bus_bytes,obstacles,rex_mode,score,dropped\n");
+	for (size_t i = 0; i < count; i++) {
+		const record_t *r = &records[i];
+		printf("%u,%.3f,%u,%u,%u,%u,%u\n", r->tick, frame_ms(r), r->bus_bytes, r->obstacles, r->rex_mode,
+			r->score, r->dropped);
+	}
+}
+
+/* One row per group of records: the slowest frame of the group as a bar, | marks one tick */
+static void print_plot(void)
+{
+	size_t per_row = (count + PLOT_ROWS - 1) / PLOT_ROWS;
+	double top = PLOT_TICKS * TICK_US / 1000.0;
+
+	printf("tick    max ms  avg ms\n");
+	for (size_t first = 0; first < count; first += per_row) {
+		size_t last = (first + per_row < count) ? first + per_row : count;
+		double high = 0, sum = 0;
+		char bar[PLOT_WIDTH + 1];
+
+		for (size_t i = first; i < last; i++) {
+			high = (frame_ms(&records[i]) > high) ? frame_ms(&records[i]) : high;
+			sum += frame_ms(&records[i]);
+		}
+		int length = (int)(high / top * PLOT_WIDTH + 0.5);
+		int tick = (int)(TICK_US / 1000.0 / top * PLOT_WIDTH + 0.5);
+		for (int x = 0; x < PLOT_WIDTH; x++) {
+			bar[x] = (x < length) ? '#' : (x == tick ? '|' : ' ');
+		}
+		if (length > PLOT_WIDTH) {
+			bar[PLOT_WIDTH - 1] = '>';
+		}
+		bar[PLOT_WIDTH] = '\0';
+		printf("%-7u %6.2f  %6.2f  %s\n", records[first].tick, high, sum / (last - first), bar);
+	}
+}
+
+int main(int argc, char **argv)
+{
+	const char *path = NULL;
+	int plot = 0;
+	FILE *in = stdin;
+
+	for (int i = 1; i < argc; i++) {
+		if (!strcmp(argv[i], "--plot")) {
+			plot = 1;
+		}
+		else if (argv[i][0] != '-' && !path) {
+			path = argv[i];
+		}
+		else {
+			usage(argv[0]);
+			return 2;
+		}
+	}
+	if (path) {
+		in = fopen(path, "rb");
+		if (!in) {
+			perror(path);
+			return 1;
+		}
+	}
+
+	size_t skipped = decode(in);
+	if (in != stdin) {
+		fclose(in);
+	}
+
+	if (plot) {
+		print_plot();
+	}
+	else {
+		print_csv();
+	}
+
+	unsigned long dropped = 0, slow = 0;
+	double total = 0, high = 0;
+	for (size_t i = 0; i < count; i++) {
+		dropped += records[i].dropped;
+		total += frame_ms(&records[i]);
+		high = (frame_ms(&records[i]) > high) ? frame_ms(&records[i]) : high;
+		slow += records[i].frame_counts * COUNT_US > TICK_US;
+	}
+	fprintf(stderr, "records           %zu\n", count);
+	fprintf(stderr, "dropped           %lu\n", dropped);
+	fprintf(stderr, "skipped bytes     %zu\n", skipped);
+	if (count) {
+		fprintf(stderr, "frame time        avg %.3f ms  max %.3f ms\n", total / count, high);
+		fprintf(stderr, "over one tick     %lu\n", slow);
+	}
+	free(records);
+	return 0;
+}
@@ -94,6 +94,11 @@
 /** defines the data direction (writing to I2C device) in i2c_start(),i2c_rep_start() */
 #define I2C_WRITE   0
 
+/** number of times i2c_start_wait() polls before it gives up, about 120 ms at 100 kHz */
+#ifndef I2C_WAIT_TRIES
+#define I2C_WAIT_TRIES  1000
+#endif
+
 
 /**
  @brief initialize the I2C master interace. Need to be called only once 
@@ -102,6 +107,17 @@
 extern void i2c_init(void);
 
 
+/**
+ @brief Raises the bus clock to the fastest speed profile the device keeps acknowledging
+
+ Steps through the profiles from slowest to fastest, stops at the first rate
+ where an address byte is not acknowledged and falls back to the last good one
+ @param    addr address of the I2C device, without the transfer direction
+ @return   index of the speed profile in use, 0 is standard mode
+ */
+extern unsigned char i2c_probe_speed(unsigned char addr);
+
+
 /** 
  @brief Terminates the data transfer and releases the I2C bus 
  @return none
@@ -132,11 +148,12 @@ extern unsigned char i2c_rep_start(unsigned char addr);
 /**
  @brief Issues a start condition and sends address and transfer direction 
    
- If device is busy, use ack polling to wait until device ready 
+ If device is busy, use ack polling to wait until device ready, giving up after a bounded number of polls
  @param    addr address and transfer direction of I2C device
- @return   none
+ @retval   0   device accessible
+ @retval   1   device never acknowledged
  */
-extern void i2c_start_wait(unsigned char addr);
+extern unsigned char i2c_start_wait(unsigned char addr);
 
  
 /**
@@ -17,156 +17,490 @@
 #include <util/delay.h>
 #include <avr/pgmspace.h>
 #include <avr/interrupt.h>
+#include <avr/sleep.h>
+#include <avr/eeprom.h>
+#include <util/crc16.h>
 #include "avr/sfr_defs.h"
 #include <stdio.h>
+#include <string.h>
 #include "i2cmaster.h"
+#include "hal.h"
 #include <time.h>
 
 #include <inttypes.h>
 #include <compat/twi.h>
 
-void sendOneCommandByte(unsigned char cmd);
-void sendTwoCommandByte(unsigned char cmdOne, unsigned char cmdTwo);
-void sendData(unsigned char data);
+void streamData(unsigned char data);
 void oled_init();
 void position(unsigned char x, unsigned char y);
-void clearDisplay();
+void panelWindow(uint8_t firstColumn, uint8_t lastColumn, uint8_t firstPage, uint8_t lastPage);
+void sendFrame();
+void flush();
+void queueCommands(const uint8_t *commands, uint8_t length);
+void queueWindow(uint8_t firstColumn, uint8_t lastColumn, uint8_t firstPage, uint8_t lastPage);
+void queueData(uint16_t length);
+uint16_t txFree();
+void twiFence();
 void clearTopTwoPages();
 void drawRex();
-void drawCactus();
-void drawPterodactyl();
+void blitSprite(uint8_t sprite, int16_t x, uint8_t y);
 void background();
+void renderPlayfield();
 void scrollLeft();
-void preventScrollBack();
-void jumpingRex();
-void jumpingOne(unsigned char top, unsigned char bottom);
-void jumpingTwo(unsigned char top, unsigned char bottom);
-void jumpingThree(unsigned char top, unsigned char middle, unsigned char bottom);
-void jumpingFour(unsigned char top, unsigned char middle, unsigned char bottom);
-void jumpingFive(unsigned char top, unsigned char middle, unsigned char bottom);
-void jumpingSix(unsigned char top, unsigned char middle, unsigned char bottom);
-void jumpingSeven(unsigned char top, unsigned char middle, unsigned char bottom);
-void jumpingEight(unsigned char top, unsigned char middle, unsigned char bottom);
-void fallingClear(unsigned char page);
-void duckingRex();
-void unduckingRex();
-void duckingOne();
-void duckingTwo();
-void duckingThree();
-void duckingFour();
-void generateRandomEnemy();
-void checkPterodactyl();
-void checkCactus();
-void activeCounter();
-uint8_t max(uint8_t one, uint8_t two);
-void collisionCheck();
+void animateRex(uint8_t stick);
+void fallRex(uint8_t modes);
+void scheduleObstacles();
+uint8_t random8();
+void initObstacles();
+void spawnObstacle(uint8_t type, int16_t x);
+void moveObstacles();
+uint8_t collisionCheck();
 void stopDisplay();
-void resetCactus();
-void resetPterodactyl();
 void gameLoop();
 void buzzerToggle();
 void buzzerOn();
 void buzzerOff();
 void gameStart();
-void letterDisplay(uint8_t x, uint8_t index);
 void stickPress();
+void startScore();
+void restartGame();
+void menuIdle();
+void powerDown();
 void gameEnd();
-void displayScore();
+void scorePoint();
 void drawScore();
 void displayNumber(int number, int x);
 void displayFinalScore();
-void letterDisplay(uint8_t x, uint8_t index);
 
 void Timer0Settings();
-void _delay_5ms();
-void _delay_10ms();
+void Timer1Settings();
+uint8_t waitForTick();
+void updateWorld();
+void replayBegin();
+uint8_t replayStep(uint8_t input);
+void replayFlush();
+void replayFinish();
+void highScoreLoad();
+void highScoreSubmit();
+uint8_t highScoreCRC(const uint8_t *slot);
+uint16_t scoreBCD();
 
 void LEDOn(void);
 void LEDOff(void);
 void ADCint(void);
-unsigned int read_adc(unsigned char adc_input);
-void convertADCToVoltage(void);
+#if defined(PROFILE) || defined(TELEMETRY)
+void uartInit();
+uint8_t uartFree();
+uint8_t uartWrite(const uint8_t *bytes, uint8_t length);
+void uartPrint(const char *text);
+uint32_t timerClock();
+uint32_t timerClockTicks(uint16_t *ticks);
+#endif
+#ifdef PROFILE
+void profileFrameEnd();
+void profileDump();
+#endif
+#ifdef TELEMETRY
+void telemetryFrameEnd();
+#endif
 
-// T-Rex Bytes
-const unsigned char Rex[][15] PROGMEM = {
-	{ 0xE0, 0xC0, 0x80, 0x00, 0x00, 0x80, 0xC0, 0xC0, 0xE0, 0xF8, 0xFC, 0x74, 0x5C, 0x5C, 0x18 },
-	{ 0x03, 0x07, 0x07, 0x0F, 0xFF, 0xBF, 0x1F, 0x0F, 0x1F, 0xFF, 0x87, 0x01, 0x03, 0x00, 0x00 }
+// Sprites and fonts, generated from sprites.txt and fonts.txt by host/assetgen
+// A sprite is an atlas: for every shift 0 to 7 the sprite moved down that many pixels, as three
+// pages of width bytes, so a sprite can be drawn at any pixel row without shifting bytes at run
+// time; every shift is packed on its own with the run length code of unpackByte()
+// Each glyph keeps its columns page by page, top page first, packed with the same code unless
+// the font is too small to gain from it
+typedef struct {
+	uint8_t width;
+	uint8_t shifts; // 8 for a full atlas, 1 for a sprite only drawn on a page boundary
+	const unsigned char *atlas;
+	uint8_t offsets[8]; // First byte of every shift in the atlas
+} Sprite;
+
+typedef struct {
+	char code;
+	uint8_t width;
+	uint8_t offset; // First byte of the glyph in the font's bitmaps
+} Glyph;
+
+typedef struct {
+	uint8_t pages; // Height in pages
+	uint8_t spacing; // Blank columns left after every glyph
+	uint8_t count;
+	uint8_t packed; // 0 when the bitmaps are stored as they are drawn
+	const Glyph *glyphs;
+	const unsigned char *bitmaps;
+} Font;
+
+// Reads a glyph's bitmap or a sprite's shift one byte at a time, see unpackByte()
+typedef struct {
+	const unsigned char *next;
+	uint8_t left; // Bytes left in the current run
+	uint8_t repeat; // The run repeats one byte rather than copying
+} Unpacker;
+
+// A sprite placed on the screen, unpacked row by row as it is drawn, see spriteLayer()
+typedef struct {
+	Unpacker bits;
+	int16_t x; // Column of the left edge
+	uint8_t width;
+	uint8_t page; // Page of the top row
+	uint8_t pages; // Rows of the shift that are drawn
+} Layer;
+
+#include "assets.h"
+
+// Hitbox of an obstacle relative to its left edge: columns left to right, and pixels above
+// the ground bottom to top, both end exclusive
+// The pterodactyl box only covers the wings hanging below its body, so a T-Rex that jumps
+// high enough to tuck its feet over them clears it
+typedef struct {
+	int16_t left;
+	int16_t right;
+	uint8_t bottom;
+	uint8_t top;
+} Box;
+
+uint8_t obstacleHit(const Box *rex, int16_t x, const Box *obstacle);
+
+// Obstacle types: the sprite, the pixel row its top is drawn at (40 stands on the ground) and its hitbox
+// A high pterodactyl flies over a standing T-Rex and has to be run under, not jumped
+typedef struct {
+	uint8_t sprite;
+	uint8_t y;
+	Box box;
+} ObstacleType;
+
+#define OBSTACLE_CACTUS 0
+#define OBSTACLE_PTERODACTYL 1
+#define OBSTACLE_HIGH_PTERODACTYL 2
+
+const ObstacleType ObstacleTypes[] PROGMEM = {
+	{ SPRITE_CACTUS, 40, { 0, 6, 0, 11 } },
+	{ SPRITE_PTERODACTYL, 40, { 0, 11, 8, 11 } },
+	{ SPRITE_PTERODACTYL, 28, { 0, 11, 20, 23 } }
 };
 
-// Cactus Bytes
-const unsigned char Cactus[][6] PROGMEM = {
-	{ 0x00, 0x00, 0xE0, 0xE0, 0x00, 0x00 },
-	{ 0x0F, 0x08, 0xFF, 0xFF, 0x08, 0x0F }
+// T-Rex keyframes, indexed by rexMode
+// sprite - standing and jumping use the T-Rex, ducking has its own four sprites
+// lift, top - hitbox, pixels from the ground to the feet and to the head
+typedef struct {
+	uint8_t sprite;
+	uint8_t lift;
+	uint8_t top;
+} Keyframe;
+
+const Keyframe Keyframes[29] PROGMEM = {
+	{ SPRITE_REX, 0, 16 }, // Standing
+	{ SPRITE_REX, 1, 17 }, { SPRITE_REX, 2, 18 }, { SPRITE_REX, 3, 19 }, { SPRITE_REX, 4, 20 }, // Rising
+	{ SPRITE_REX, 5, 21 }, { SPRITE_REX, 6, 22 }, { SPRITE_REX, 7, 23 }, { SPRITE_REX, 8, 24 },
+	{ SPRITE_REX, 9, 25 }, { SPRITE_REX, 10, 26 }, { SPRITE_REX, 11, 27 }, { SPRITE_REX, 12, 28 },
+	{ SPRITE_REX, 13, 29 }, { SPRITE_REX, 14, 30 }, { SPRITE_REX, 15, 31 }, { SPRITE_REX, 16, 32 },
+	{ SPRITE_REX, 17, 33 }, { SPRITE_REX, 18, 34 }, { SPRITE_REX, 19, 35 }, { SPRITE_REX, 20, 36 },
+	{ SPRITE_REX, 21, 37 }, { SPRITE_REX, 22, 38 }, { SPRITE_REX, 23, 39 }, { SPRITE_REX, 24, 40 }, // Top of the jump
+	{ SPRITE_DUCK_ONE, 0, 14 }, { SPRITE_DUCK_TWO, 0, 12 }, { SPRITE_DUCK_THREE, 0, 9 }, { SPRITE_DUCK_FOUR, 0, 8 } // Ducking
 };
 
-// Pterodactyl Bytes
-const unsigned char Pterodactyl[11] PROGMEM = {
-	0x04, 0x06, 0x07, 0x0C, 0xFC, 0x7C, 0x1C, 0x1C, 0x14, 0x14, 0x04 
+// Ground Bytes, repeated along the 7th page
+const unsigned char Ground[8] PROGMEM = {
+	0xFE, 0xFD, 0xF7, 0xBF, 0xEF, 0xFB, 0x7F, 0xDF
 };
 
-// Two Page Letter Bytes
-const unsigned char Letters[][14] PROGMEM = {
-	{ 0xFF, 0x41, 0x41, 0x41, 0x41, 0x3E, 0x00, 0xFF, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00 }, //P
-	{ 0xFF, 0x00, 0x00, 0x00, 0x00, 0xFF, 0x00, 0xFF, 0x80, 0x80, 0x80, 0x80, 0xFF, 0x00 }, //U
-	{ 0xFF, 0x81, 0x81, 0x81, 0x81, 0x81, 0x00, 0x80, 0x80, 0x80, 0x80, 0x80, 0xFF, 0x00 }, //S
-	{ 0xFF, 0x80, 0x80, 0x80, 0x80, 0xFF, 0x00, 0xFF, 0x00, 0x00, 0x00, 0x00, 0xFF, 0x00 }, //H
-	{ 0x01, 0x01, 0x01, 0xFF, 0x01, 0x01, 0x01, 0x00, 0x00, 0x00, 0xFF, 0x00, 0x00, 0x00 }, //T
-	{ 0xFF, 0x01, 0x01, 0x01, 0x01, 0xFF, 0x00, 0xFF, 0x80, 0x80, 0x80, 0x80, 0xFF, 0x00 }, //O
-	{ 0x01, 0x01, 0x01, 0xFF, 0x01, 0x01, 0x01, 0x80, 0x80, 0x80, 0xFF, 0x80, 0x80, 0x80 }, //I
-	{ 0xFF, 0x01, 0x01, 0x01, 0x01, 0x01, 0x00, 0xFF, 0x80, 0x80, 0x80, 0x80, 0x80, 0x00 }, //C
-	{ 0xFF, 0x80, 0x40, 0x30, 0x0C, 0x03, 0x00, 0xFF, 0x01, 0x02, 0x0C, 0x30, 0xC0, 0x00 }, //K
-	{ 0xFF, 0x81, 0x81, 0x81, 0x81, 0xFF, 0x00, 0xFF, 0x00, 0x00, 0x00, 0x00, 0xFF, 0x00 }, //A
-	{ 0xFF, 0xC1, 0x41, 0x41, 0x41, 0x3E, 0x00, 0xFF, 0x00, 0x03, 0x0C, 0x30, 0xC0, 0x00 }, //R
-	{ 0xFF, 0x81, 0x81, 0x81, 0x81, 0x01, 0x00, 0xFF, 0x80, 0x80, 0x80, 0x80, 0x80, 0x00 }, //E
-	{ 0xFF, 0x0F, 0xF0, 0x00, 0x00, 0xFF, 0x00, 0xFF, 0x00, 0x00, 0x0F, 0xF0, 0xFF, 0x00 } //N
-};
+uint8_t unpackByte(Unpacker *bits);
+void spriteLayer(Layer *layer, uint8_t sprite, int16_t x, uint8_t y);
+uint8_t drawGlyph(uint8_t x, uint8_t page, const Font *font, char code);
+uint8_t drawText(uint8_t x, uint8_t page, const Font *font, const char *text);
 
-// One Page Letter Bytes
-const unsigned char scoreLetters[][5] PROGMEM = {
-	{ 0x8F, 0x89, 0x89, 0x89, 0xF9 }, //S
-	{ 0xFF, 0x81, 0x81, 0x81, 0x81 }, //C
-	{ 0xFF, 0x81, 0x81, 0x81, 0xFF }, //O
-	{ 0xFF, 0x19, 0x29, 0x49, 0x86 }, //R
-	{ 0xFF, 0x89, 0x89, 0x89, 0x81 } //E
-};
+uint8_t rexMode = 0; // Current entry of Keyframes
+uint8_t rexState = 0;
+uint8_t resetCount = 0;
+volatile uint8_t restartRequested = 0; // Set by the touch sensor once a game has ended
+uint8_t gameOver = 0;
+uint8_t pressCondition = 1;
+
+// Score
+// Kept as one decimal digit per byte, thousands first, so a point is added in place
+// without any division and only the digits that carried are redrawn
+#define SCORE_DIGITS 4
+#define SCORE_X 38 // Column of the thousands digit during the game
+#define FINAL_SCORE_X 102 // Column of the thousands digit on the end screen
+#define DIGIT_SPACING 6
+uint8_t scoreDigits[SCORE_DIGITS] = { 0, 0, 0, 0 };
+
+// Game tick
+#define TICK_HZ 40 // Update steps per second, one frame is rendered per tick when the bus keeps up
+#define MAX_CATCH_UP 4 // Most update steps run before a frame is rendered again
+#define BUZZ_TICKS 1 // Ticks the buzzer sounds for on a jump
+#define BUZZ_END_TICKS (2 * TICK_HZ) // Ticks the buzzer sounds for when the game is lost
+#define MENU_SLEEP_TICKS (20 * TICK_HZ) // Ticks the title or end screen waits for the player before powering down
+volatile uint8_t ticks = 0; // Ticks not yet consumed by the update step
+uint16_t skippedFrames = 0; // Ticks of this game updated but never rendered because a frame overran, see profileDump()
+uint8_t buzzerTicks = 0;
+uint16_t menuTicks = 0; // Ticks the screen on show has waited for the player
+
+// Input
+// Every Timer 0 overflow triggers one ADC conversion of the joystick and ISR(ADC_vect) keeps
+// the settled result, so the game reads the stick and the button without ever waiting
+// The thresholds have hysteresis so a stick resting near one does not flicker across it
+#define STICK_REST 0
+#define STICK_UP 1
+#define STICK_DOWN 2
+#define STICK_UP_ENTER 300 // Readings below this tilt the stick up
+#define STICK_UP_LEAVE 340 // and it only counts as back at rest above this
+#define STICK_DOWN_ENTER 650 // Readings above this tilt the stick down
+#define STICK_DOWN_LEAVE 610 // and it only counts as back at rest below this
+#define BUTTON_SAMPLES 0x07 // The button has to read the same on three samples in a row
+volatile uint8_t stickState = STICK_REST;
+volatile uint8_t buttonDown = 0; // Debounced joystick push button
+uint8_t buttonHistory = 0; // Last samples of the button, newest in bit 0
+
+// Replay
+// Holding the touch sensor at power on records the first game to EEPROM: the seed, then the inputs
+// of every update step, run length encoded one byte per run: stick state in bits 7-6 and the run
+// length minus one in bits 5-0
+// Holding the joystick button at power on plays the last recorded game back step for step
+// Every other game leaves the EEPROM alone, so it only wears for the games asked for
+#define REPLAY_OFF 0
+#define REPLAY_RECORD 1
+#define REPLAY_PLAYBACK 2
+#define REPLAY_MAGIC 0xD2 // Only written once the game has ended, a cut short recording is never played
+#define REPLAY_MAGIC_ADDRESS 0
+#define REPLAY_SEED_ADDRESS 1
+#define REPLAY_RUNS_START 3
+#define REPLAY_RUNS_END 0x380 // The rest of the EEPROM is left for other uses
+#define REPLAY_STICK_SHIFT 6
+#define REPLAY_LENGTH 0x3F
+#define REPLAY_END_OF_RUNS 0xFF // No stick state uses both top bits, erased EEPROM reads as the end
+uint8_t replayMode = REPLAY_OFF;
+uint8_t replayInput = 0; // Inputs of the current run
+uint8_t replayLeft = 0; // Steps in the current run, recorded so far or still to play back
+uint8_t *replayAddress = (uint8_t *)REPLAY_RUNS_START; // Next run in EEPROM
+
+// High scores
+// The best scores live in the EEPROM above the replay as a ring of slots, each holding the whole
+// table: a sequence number, the scores as BCD low byte first and a CRC of the bytes before it
+// A save goes to the slot after the newest one, so a write cut short by a reset or a brown out
+// fails its CRC and leaves the table before it standing, and the wear is spread over the ring
+// ISR(EE_READY_vect) writes the slot a byte at a time, the game never waits on the EEPROM
+#define HIGH_SCORES 3 // Scores kept, best first
+#define HIGH_SCORE_START REPLAY_RUNS_END
+#define HIGH_SCORE_SLOT_SIZE (2 + 2 * HIGH_SCORES)
+#define HIGH_SCORE_SLOTS ((E2END + 1 - HIGH_SCORE_START) / HIGH_SCORE_SLOT_SIZE)
+uint16_t highScores[HIGH_SCORES] = { 0 }; // Four BCD digits each, thousands in the top nibble
+uint8_t highScoreSlot = HIGH_SCORE_SLOTS - 1; // Slot of the newest table, the next save goes to the one after
+uint8_t highScoreSequence = 0xFF;
+uint8_t highScoreBuffer[HIGH_SCORE_SLOT_SIZE]; // The slot ISR(EE_READY_vect) is writing
+volatile uint8_t highScoreWritten = HIGH_SCORE_SLOT_SIZE; // Bytes of it already written
+
+// Instrumentation
+// PROFILE and TELEMETRY builds share the UART, sent from a ring by ISR(USART_UDRE_vect) so the
+// game never waits on it, and a clock in Timer 1 counts (16 us) that runs on across ticks
+#if defined(PROFILE) || defined(TELEMETRY)
+#define INSTRUMENTED
+#define UART_BAUD 115200
+#define UART_BUFFER_SIZE 32 // A power of two, two telemetry records, each takes about 1.1 ms to send
+uint8_t uartBuffer[UART_BUFFER_SIZE];
+volatile uint8_t uartHead = 0; // Next free byte, only the main loop moves it
+volatile uint8_t uartTail = 0; // Next byte to send, only the ISR moves it
+volatile uint16_t clockTicks = 0; // Timer 1 compare matches, the high part of timerClock()
+#define CLOCK_TICK() (clockTicks++)
+#else
+#define CLOCK_TICK()
+#endif
+
+// Profiling
+// Building with PROFILE defined timestamps the phases of every frame on Timer 1 (16 us steps)
+// and counts the display transactions and bytes queued, the last PROFILE_FRAMES frames are
+// kept and a byte received on the UART dumps their min/avg/max
+// Without PROFILE the macros are empty and none of it is compiled in
+#ifdef PROFILE
+#define PROFILE_INPUT 0 // Replay and T-Rex animator
+#define PROFILE_COLLISION 1
+#define PROFILE_OBSTACLES 2 // Moving and spawning, includes PROFILE_SCORE
+#define PROFILE_SCORE 3
+#define PROFILE_DRAW 4 // Rendering the playfield into the framebuffer
+#define PROFILE_SEND 5 // Copying the frame into txBuffer and queueing it
+#define PROFILE_PHASES 6
+#define PROFILE_FRAMES 4 // A power of two, RAM is short
+typedef struct {
+	uint16_t time[PROFILE_PHASES]; // Timer 1 counts spent in each phase
+	uint8_t transactions;
+	uint16_t bytes; // Address and control bytes included
+} FrameProfile;
+FrameProfile profileFrames[PROFILE_FRAMES];
+FrameProfile profileCurrent;
+uint8_t profileHead = 0; // Next slot of profileFrames
+uint8_t profileCount = 0; // Frames kept so far
+uint16_t profileStart[PROFILE_PHASES]; // Low half of timerClock(), a phase never spans 16 bits of it
+#define PROFILE_BEGIN(phase) (profileStart[phase] = (uint16_t)timerClock())
+#define PROFILE_END(phase) (profileCurrent.time[phase] += (uint16_t)timerClock() - profileStart[phase])
+#define PROFILE_TRANSFER(length) (profileCurrent.transactions++, profileCurrent.bytes += (length) + 2)
+#define PROFILE_FRAME_END() profileFrameEnd()
+#else
+#define PROFILE_BEGIN(phase)
+#define PROFILE_END(phase)
+#define PROFILE_TRANSFER(length)
+#define PROFILE_FRAME_END()
+#endif
+
+// Telemetry
+// Building with TELEMETRY defined sends one binary record over the UART for every frame:
+// sync byte, tick, frame time in Timer 1 counts, display bytes queued (16 bits each, low byte
+// first), active obstacles, rexMode, score as four BCD digits (16 bits), records dropped
+// before this one and the sum of the bytes after the sync byte
+// A record that does not fit in the UART ring is dropped, the game never waits for it
+#ifdef TELEMETRY
+#define TELEMETRY_SYNC 0xA5
+#define TELEMETRY_RECORD 13
+uint32_t telemetryStart = 0; // timerClock() when the frame started
+uint16_t telemetryBytes = 0; // Display bytes queued during the frame
+uint8_t telemetryDropped = 0;
+#define TELEMETRY_TRANSFER(length) (telemetryBytes += (length) + 2)
+#define TELEMETRY_FRAME_END() telemetryFrameEnd()
+#else
+#define TELEMETRY_TRANSFER(length)
+#define TELEMETRY_FRAME_END()
+#endif
 
-// One Page Number Bytes
-const unsigned char numbers[][4] PROGMEM = {
-	{ 0xFF, 0x81, 0x81, 0xFF }, //0
-	{ 0x00, 0xFF, 0x00, 0x00 }, //1
-	{ 0xF9, 0x89, 0x89, 0x8F }, //2
-	{ 0x89, 0x89, 0x89, 0xFF }, //3
-	{ 0x0F, 0x08, 0x08, 0xFF }, //4
-	{ 0x8F, 0x89, 0x89, 0xF9 }, //5
-	{ 0xFF, 0x89, 0x89, 0xF9 }, //6
-	{ 0x01, 0x01, 0x01, 0xFF }, //7
-	{ 0xFF, 0x89, 0x89, 0xFF }, //8
-	{ 0x0F, 0x09, 0x09, 0xFF }, //9
+// T-Rex animator states
+#define REX_RUNNING 0
+#define REX_RISING 1
+#define REX_FALLING 2
+#define REX_DUCKING 3
+#define REX_UNDUCKING 4
+#define JUMP_TOP 24 // Mode at the top of a jump
+#define FAST_FALL 3 // Modes dropped per tick while the stick is held down in the air
+
+// World
+#define REX_X 8 // Column of the left edge of the T-Rex
+#define REX_WIDTH 15
+#define GROUND_Y 40 // Pixel row of the top of a two page sprite standing on the ground
+#define SPAWN_X 128 // Column a new obstacle appears at, it slides in from off the right edge
+uint8_t groundOffset = 0; // Position in the ground pattern of the first column
+
+// Speed and spawning
+// Speed is in 8.8 fixed point pixels per tick, the fraction carries over between ticks
+// Every obstacle cleared adds SPEED_RAMP until SPEED_MAX
+#define SPEED_START 0x0100 // 1 pixel per tick
+#define SPEED_RAMP 4 // 1/64 of a pixel per tick for every point
+#define SPEED_MAX 0x0280 // 2.5 pixels per tick
+#define FIRST_GAP 128 // Pixels before the first obstacle
+// Shortest gap after an obstacle, in ticks of travel at the current speed
+// A full jump lasts 47 ticks, the rest leaves time to land and react
+#define MIN_GAP_TICKS 56
+#define GAP_SPREAD 0x3F // Up to this many extra pixels are added to every gap
+#define CLUSTER_SPEED 0x0140 // Two cacti side by side need at least this speed to be cleared in one jump
+#define CLUSTER_SPACING 7 // Columns between the left edges of a cactus cluster
+uint16_t scrollSpeed = SPEED_START;
+uint8_t scrollFraction = 0; // Fraction of a pixel carried to the next tick
+uint8_t scrollStep = 0; // Whole pixels the world moved on this tick
+int16_t spawnDistance = FIRST_GAP; // Pixels left to travel before the next obstacle is sent
+uint16_t randomState = 0xACE1; // Never zero, the generator would get stuck
+
+// Obstacle pool
+// Struct of arrays indexed by slot, every slot is on either the active list or the free list
+// so spawning, moving, drawing and collision checks only ever touch active obstacles
+#define MAX_OBSTACLES 8
+#define NO_OBSTACLE 0xFF // End of a list
+int16_t obstacleX[MAX_OBSTACLES]; // Column of the left edge
+uint8_t obstacleType[MAX_OBSTACLES]; // Entry of ObstacleTypes
+uint8_t obstacleNext[MAX_OBSTACLES]; // Next slot on the same list
+uint8_t activeObstacles = NO_OBSTACLE;
+uint8_t freeObstacles = NO_OBSTACLE;
+
+// Framebuffer
+// Draw routines write into a page organised copy of the panel and flush() sends only
+// the columns that changed since the last flush
+#define CLEAN 0xFF // Marks a page with no dirty columns
+// Bus bytes a window costs on top of its data: two address bytes, two control bytes
+// and the six bytes of the column and page range commands
+#define WINDOW_COST 10
+uint8_t frameBuffer[8][128];
+uint8_t dirtyStart[8] = { CLEAN, CLEAN, CLEAN, CLEAN, CLEAN, CLEAN, CLEAN, CLEAN }; // First changed column of each page
+uint8_t dirtyEnd[8] = { CLEAN, CLEAN, CLEAN, CLEAN, CLEAN, CLEAN, CLEAN, CLEAN }; // Last changed column of each page
+uint8_t fbColumn = 0;
+uint8_t fbPage = 0;
+
+// Display transfers
+// Transactions to the OLED wait in a ring and ISR(TWI_vect) sends them while the game runs on
+// A transaction is either a few commands or a run of data bytes waiting in txBuffer
+#define TWI_QUEUE_SIZE 8 // Entries in the ring, a power of two, a busy frame queues about 6
+#define TWI_COMMAND_BYTES 6 // Most commands one entry carries
+#define TWI_COMMANDS 0x00 // Control byte: the bytes that follow are commands
+#define TWI_DATA 0x40 // Control byte: the bytes that follow go to GDDRAM
+typedef struct {
+	uint8_t control;
+	uint16_t length; // Number of commands, or of data bytes in txBuffer
+	uint8_t commands[TWI_COMMAND_BYTES];
+} TwiTransfer;
+TwiTransfer *nextTransfer();
+void commitTransfer();
+TwiTransfer twiQueue[TWI_QUEUE_SIZE];
+volatile uint8_t twiHead = 0; // Next free entry
+volatile uint8_t twiTail = 0; // Entry on the bus
+volatile uint8_t twiBusy = 0; // Set while the ISR owns the bus
+uint16_t twiSent = 0; // Bytes of the current entry sent so far
+volatile uint16_t twiErrors = 0; // Entries dropped because the OLED did not acknowledge, see profileDump()
+
+// OLED setup
+// The whole init sequence goes out as one command transaction at boot, it ends on a window
+// over the full panel so the clear that follows is one data burst
+#define OLED_ADDRESS 0x78
+#define OLED_BYTES 1024 // 128 columns by 8 pages
+const uint8_t OledInit[] PROGMEM = {
+	0xAE, // Display off
+	0xD5, 0x80, // Clock divide ratio and oscillator frequency
+	0xA8, 0x3F, // Multiplex ratio, 64 rows
+	0xD3, 0x00, // No display offset
+	0x40, // Start line 0
+	0xA1, // Column 127 is segment 0
+	0xC8, // COM scan from the bottom up
+	0xDA, 0x12, // Alternative COM pin layout
+	0x81, 0x66, // Contrast
+	0xD9, 0xF1, // Precharge periods
+	0xD8, 0x30,
+	0xA4, // Show GDDRAM
+	0xA6, // Not inverted
+	0x8D, 0x14, // Charge pump on
+	0x20, 0x00, // Horizontal addressing, flush() sends every update as a column and page window
+	0x21, 0, 127, // Every column
+	0x22, 0, 7 // Every page
 };
 
-uint8_t scrollCount = 0;
-uint8_t cactusOne = 0;
-uint8_t cactusTwo = 0;
-uint8_t pteroOne = 0;
-uint8_t pteroTwo = 0;
-uint8_t rexMode = 0;
-uint8_t stop = 0;
-uint8_t resetCount = 0;
-uint8_t pressCondition = 1;
-float score = 0;
-int lastOnes = 0;
-int lastTens = 0;
-int lastHundreds = 0;
-int lastThousands = 0;
+// Transmit buffer
+// There is no room for a second framebuffer, so the back buffer is a ring the changed spans of
+// a frame are copied into: once sendFrame() returns the game composes the next frame in
+// frameBuffer while this one is still being shifted out
+// A frame bigger than the ring is copied as the ISR makes room, one page row at a time
+#define TX_BUFFER_SIZE 512 // A power of two, typical frames fit several times over
+#define TX_CHUNK 256 // Most data bytes in one transaction, so a chunk can always be completed
+uint8_t txBuffer[TX_BUFFER_SIZE];
+uint16_t txHead = 0; // Next free byte, only the main loop moves it
+volatile uint16_t txTail = 0; // Next byte to send, only the ISR moves it
 
 int main (void) {
-	DDRC = 0x04; // Reset Toggle output
-	PORTC |= 0x04; // Setting Reset to logic 1
+	RESET_OUTPUT(); // Reset Toggle output
+	RESET_HIGH(); // Setting Reset to logic 1
+	// The button held through power on asks for the last game to be played back,
+	// the touch sensor for the first game to be recorded
+	if (STICK_PRESSED() && (eeprom_read_byte((const uint8_t *)REPLAY_MAGIC_ADDRESS) == REPLAY_MAGIC)) {
+		replayMode = REPLAY_PLAYBACK;
+	}
+	else if (TOUCH_HELD()) {
+		replayMode = REPLAY_RECORD;
+	}
+	highScoreLoad(); // The best scores so far, for the end screen
     i2c_init(); // Initializing the OLED
-	DDRD = 0x90;	// Sets PD5 to an output for the LED
+	sei(); // Everything sent to the OLED from here on is interrupt driven
+	LED_OUTPUT(); // Sets PD4 to an output for the LED
+	BUZZER_OUTPUT(); // and PD7 for the buzzer
 	ADCint(); // Initializing the ADC
 	oled_init(); // Initializing the OLED
 	Timer0Settings(); // Timer 0 Settings
+	Timer1Settings(); // Timer 1 Settings, the game tick
+#ifdef INSTRUMENTED
+	uartInit(); // UART for the profile dump and the telemetry
+#endif
 	
 	
 	// External Interrupt Control Register
@@ -177,225 +511,381 @@ int main (void) {
 	// INT1 - 1
 	// External Interrupt Request 1 Enable
 	EIMSK |= (1 << INT1);
-	sei();
 	
 	gameStart(); // Display the start message to the screen
 	background(); // Displays the background
 	drawRex(); // Displays a T-Rex
+	flush();
+	initObstacles();
 	stickPress(); // Waits to start game until button has been pressed
-	gameLoop(); // Loop while game is running
-
+	while (1) {
+		replayBegin(); // Starts recording the game if asked to, or loads the one to play back
+		gameLoop(); // Loop while game is running
+		replayFinish(); // Closes the recording
+		stopDisplay(); // Shows the end of game screens
+		// Nothing left to do until the touch sensor asks for the next game
+		menuTicks = 0;
+		while (!restartRequested) {
+			menuIdle();
+		}
+		restartGame(); // Straight back into a game, the OLED keeps its setup
+	}
+	return 0;
 }
 
 // Loops until the joystick is pressed down
+// A playback starts straight away
 void stickPress() {
 	while(pressCondition) {
-		if ((PIND & 0x40) == 0) {
+		if (buttonDown || (replayMode == REPLAY_PLAYBACK)) {
 			clearTopTwoPages(); // Clears the message from the top of screen
-			while ((PIND & 0x40) == 0) {
-				
-			}
-			drawScore(); // Draw the letter for score
-			// Displays 0 0 0 0 on the screen
-			displayNumber(0, 38);
-			displayNumber(0, 44);
-			displayNumber(0, 50);
-			displayNumber(0, 56);
+			HAL_IDLE_WHILE(buttonDown);
+			startScore();
 			pressCondition = 0;
 		}
+		else {
+			menuIdle();
+		}
+	}
+}
+
+// Shows SCORE: 0000 at the top of the screen and seeds the obstacles of the new game
+void startScore() {
+	drawScore(); // Draw the letter for score
+	// Displays 0 0 0 0 on the screen
+	for (uint8_t i = 0; i < SCORE_DIGITS; i++) {
+		displayNumber(0, SCORE_X + i * DIGIT_SPACING);
+	}
+	flush();
+	// The player decides when the timer is read, which makes a good seed
+	randomState ^= TCNT1;
+	if (randomState == 0) {
+		randomState = 0xACE1;
 	}
 }
 
+// Puts the game back where the first press of the button left it, without resetting the board
+// The OLED keeps its setup and the framebuffer its contents, so only the bytes that differ from
+// a fresh playfield go over the bus and the next game starts on the following tick
+void restartGame() {
+	restartRequested = 0;
+	resetCount = 0;
+	gameOver = 0;
+	replayMode = REPLAY_OFF; // Only power on records a game or plays one back
+	
+	rexMode = 0;
+	rexState = REX_RUNNING;
+	memset(scoreDigits, 0, sizeof(scoreDigits));
+	groundOffset = 0;
+	scrollSpeed = SPEED_START;
+	scrollFraction = 0;
+	scrollStep = 0;
+	spawnDistance = FIRST_GAP;
+	skippedFrames = 0;
+	buzzerTicks = 0;
+	buzzerOff();
+	initObstacles();
+	
+	clearTopTwoPages(); // Clears the message from the top of screen
+	renderPlayfield(); // Clears the final score and the obstacles, draws the standing T-Rex
+	startScore();
+}
+
 // Loop for the game
+// Every pass is one tick: read the joystick, step the T-Rex, end the frame
+// Returns once the T-Rex has hit an obstacle
 void gameLoop() {
-	while(1) {
-		preventScrollBack(); // Clears the first eight vertical lines on the 6th page
-		drawRex(); // Displays a T-Rex on the screen
+	ticks = 0; // Ticks that passed on the start screen are not owed to the world
+	while(!gameOver) {
 		scrollLeft(); // Shifts the content on the OLED one pixel to the left
-		unsigned int adcReading = read_adc((unsigned char)0x00); // Reading the ADC output
-		// Checking if the joystick is tilted up
-		if (adcReading < 300) {
-			LEDOn(); // Turn LED on
-			buzzerToggle(); // Sounds the buzzer shortly
-			jumpingRex(); // Jumping animation
-		}
-		//Checking if the joystick is tilted down
-		else if (adcReading > 650) {
-			duckingRex(); // Ducking animation
-			// Checking when the joystick returns to rest position
-			while(adcReading > 650) {
-				duckingFour(); // Keeps the T-Rex in ducking mode as long as the stick is tilted down
-				adcReading = read_adc((unsigned char)0x00); // Reading the ADC output
-				preventScrollBack(); // Clears the first eight vertical lines on the 6th page
-				scrollLeft(); // Shifts the content on the OLED one pixel to the left
-				_delay_5ms();
-			}
-			unduckingRex(); // Animation that returns the T-Rex to original position when the joystick is return to rest position
-		}
-		else {
-			LEDOff(); // LED is off when joystick is in rest position
-		}
-		
-		_delay_5ms();
 	}
 }
 
 // Checks if the T-Rex has collided with an active object
-void collisionCheck() {
-	uint8_t tempMax = max(max(cactusOne, cactusTwo), max(pteroOne, pteroTwo)); // Checks which active object is closest to collision point
-	// Checks which object is active
-	if (tempMax != 0) {
-		// First Cactus
-		if (cactusOne == tempMax) {
-			// Checks if the T-Rex will collide with the cactus one pixel before entering collision zone
-			if ((cactusOne == 98) && !((rexMode >= 10) && (rexMode <= 24))) {
-				stopDisplay();
-			}
-			// Checks if the T-Rex will collide with the cactus while in collision zone
-			else if ((cactusOne > 98) && !((rexMode >= 11) && (rexMode <= 24))) {
-				stopDisplay();
-			}
-		}
-		// Second Cactus
-		else if (cactusTwo == tempMax) {
-			// Checks if the T-Rex will collide with the cactus one pixel before entering collision zone
-			if ((cactusTwo == 98) && !((rexMode >= 10) && (rexMode <= 24))) {
-				stopDisplay();
-			}
-			// Checks if the T-Rex will collide with the cactus while in collision zone
-			else if ((cactusTwo > 98) && !((rexMode >= 11) && (rexMode <= 24))) {
-				stopDisplay();
-			}
-		}
-		// First pterodactyl
-		else if (pteroOne == tempMax) {
-			// Checks if the T-Rex will collide with the pterodactyl one pixel before entering collision zone
-			if ((pteroOne == 92) && !((rexMode >= 10) && (rexMode <= 24)) && !(rexMode >= 27)) {
-				stopDisplay();
-			}
-			// Checks if the T-Rex will collide with the pterodactyl while in collision zone
-			else if ((pteroOne > 92) && !((rexMode >= 11) && (rexMode <= 24)) && !(rexMode == 28)) {
-				stopDisplay();
-			}
-		}
-		// Second pterodactyl
-		else if (pteroTwo == tempMax) {
-			// Checks if the T-Rex will collide with the pterodactyl one pixel before entering collision zone
-			if ((pteroTwo == 92) && !((rexMode >= 10) && (rexMode <= 24)) && !(rexMode >= 27)) {
-				stopDisplay();
-			}
-			// Checks if the T-Rex will collide with the pterodactyl while in collision zone
-			else if ((pteroTwo > 92) && !((rexMode >= 11) && (rexMode <= 24)) && !(rexMode == 28)) {
-				stopDisplay();
-			}
+// Axis aligned bounding boxes: columns across the screen, and pixels above the ground upwards
+// The T-Rex box comes from the hitbox of its current keyframe
+uint8_t collisionCheck() {
+	Box rex = { REX_X, REX_X + REX_WIDTH, pgm_read_byte(&Keyframes[rexMode].lift), pgm_read_byte(&Keyframes[rexMode].top) };
+	Box obstacle;
+	
+	for (uint8_t i = activeObstacles; i != NO_OBSTACLE; i = obstacleNext[i]) {
+		memcpy_P(&obstacle, &ObstacleTypes[obstacleType[i]].box, sizeof(Box));
+		if (obstacleHit(&rex, obstacleX[i], &obstacle)) {
+			return 1;
 		}
-		
-	}
-}
-
-// Deactivates a cactus once it is cleared
-void resetCactus() {
-	if (cactusOne >= 119) {
-		cactusOne = 0;
-		score++;
-	}
-	else if (cactusTwo >= 119) {
-		cactusTwo = 0;
-		score++;
 	}
-	displayScore();
+	return 0;
 }
 
-// Deactivates a pterodactyl once it is cleared
-void resetPterodactyl() {
-	if (pteroOne >= 119) {
-		pteroOne = 0;
-		score++;
-	}
-	else if (pteroTwo >= 119) {
-		pteroTwo = 0;
-		score++;
-	}
-	displayScore();
+// Checks if the T-Rex box overlaps an obstacle whose left edge is at column x
+// The obstacle box is given relative to that column
+uint8_t obstacleHit(const Box *rex, int16_t x, const Box *obstacle) {
+	return (rex->left < x + obstacle->right) && (x + obstacle->left < rex->right)
+		&& (rex->bottom < obstacle->top) && (obstacle->bottom < rex->top);
 }
 
 // Stop the display when a collision has occurred
 void stopDisplay() {
-	sendOneCommandByte(0x2E); // Stops the screen from scrolling
 	clearTopTwoPages(); // Clears the score from the screen
 	gameEnd(); // Displays the message to reset the screen
+	flush();
 	if (resetCount == 0) {
+		highScoreSubmit(); // Saves the score if it made the table, in the background
 		displayFinalScore(); // Displays the final score on a lower part of the screen
+		flush();
 		buzzerOn(); // Sounds the buzzer when the game has ended
-		_delay_ms(2000);
+		for (uint8_t waited = 0; waited < BUZZ_END_TICKS; ) {
+			waited += waitForTick();
+		}
 		buzzerOff(); // Turns the buzzer off
 		resetCount++;
 	}
 }
 
-// Finds the max between two 8 bit values
-uint8_t max(uint8_t one, uint8_t two) {
-	if (one > two) {
-		return one;
+// Puts every slot of the obstacle pool on the free list
+void initObstacles() {
+	for (uint8_t i = 0; i < MAX_OBSTACLES; i++) {
+		obstacleNext[i] = i + 1;
 	}
-	else {
-		return two;
+	obstacleNext[MAX_OBSTACLES - 1] = NO_OBSTACLE;
+	freeObstacles = 0;
+	activeObstacles = NO_OBSTACLE;
+}
+
+// Takes a slot off the free list for a new obstacle with its left edge at column x
+// Nothing spawns while the pool is full
+void spawnObstacle(uint8_t type, int16_t x) {
+	uint8_t i = freeObstacles;
+	if (i == NO_OBSTACLE) {
+		return;
+	}
+	freeObstacles = obstacleNext[i];
+	obstacleX[i] = x;
+	obstacleType[i] = type;
+	obstacleNext[i] = activeObstacles;
+	activeObstacles = i;
+}
+
+// Moves every active obstacle left with the world
+// An obstacle that has left the screen is cleared, it scores and its slot goes back on the free list
+void moveObstacles() {
+	uint8_t previous = NO_OBSTACLE;
+	uint8_t i = activeObstacles;
+	
+	while (i != NO_OBSTACLE) {
+		uint8_t next = obstacleNext[i];
+		uint8_t width = pgm_read_byte(&Sprites[pgm_read_byte(&ObstacleTypes[obstacleType[i]].sprite)].width);
+		obstacleX[i] -= scrollStep;
+		if (obstacleX[i] + width <= 0) {
+			if (previous == NO_OBSTACLE) {
+				activeObstacles = next;
+			}
+			else {
+				obstacleNext[previous] = next;
+			}
+			obstacleNext[i] = freeObstacles;
+			freeObstacles = i;
+			scorePoint();
+			// The game speeds up with every obstacle cleared
+			if (scrollSpeed < SPEED_MAX) {
+				scrollSpeed += SPEED_RAMP;
+			}
+		}
+		else {
+			previous = i;
+		}
+		i = next;
 	}
 }
 
-// Counts for each active object every time the screen is shifted one pixel
-void activeCounter() {
-	if (cactusOne > 0) {
-		cactusOne++;
+// Sends the next obstacle once the world has travelled far enough since the last one
+// The gap after it is at least MIN_GAP_TICKS of travel at the current speed so every pattern
+// can be jumped or ducked, plus a random spread so the rhythm cannot be learnt
+void scheduleObstacles() {
+	spawnDistance -= scrollStep;
+	if (spawnDistance > 0) {
+		return;
 	}
-	if (cactusTwo > 0) {
-		cactusTwo++;
+	
+	uint8_t pick = random8() & 0x07;
+	uint8_t width;
+	// Cacti are the most common, clusters only once the game is fast enough to clear them
+	if (pick < 4) {
+		spawnObstacle(OBSTACLE_CACTUS, SPAWN_X);
+		width = 6;
+		if ((pick == 3) && (scrollSpeed >= CLUSTER_SPEED)) {
+			spawnObstacle(OBSTACLE_CACTUS, SPAWN_X + CLUSTER_SPACING);
+			width += CLUSTER_SPACING;
+		}
 	}
-	if (pteroOne > 0) {
-		pteroOne++;
+	else if (pick < 7) {
+		spawnObstacle(OBSTACLE_PTERODACTYL, SPAWN_X);
+		width = 11;
 	}
-	if (pteroTwo > 0) {
-		pteroTwo++;
+	else {
+		spawnObstacle(OBSTACLE_HIGH_PTERODACTYL, SPAWN_X);
+		width = 11;
 	}
+	spawnDistance += width + (int16_t)((MIN_GAP_TICKS * scrollSpeed) >> 8) + (random8() & GAP_SPREAD);
 }
 
-// Makes an cactus active when it is displayed on the screen
-void checkCactus() {
-	if (cactusOne == 0) {
-		cactusOne++;
+// Returns the next byte of a 16 bit xorshift generator
+// Shifts and XORs only, so it costs a handful of cycles where rand() costs a long multiply
+uint8_t random8() {
+	randomState ^= randomState << 7;
+	randomState ^= randomState >> 9;
+	randomState ^= randomState << 8;
+	return (uint8_t)randomState;
+}
+
+// Records the seed of a new game, or replaces it with the recorded one for a playback
+// The magic byte is cleared first so the old recording is gone once this one starts over it
+void replayBegin() {
+	if (replayMode == REPLAY_PLAYBACK) {
+		randomState = eeprom_read_word((const uint16_t *)REPLAY_SEED_ADDRESS);
 	}
-	else if (cactusTwo == 0) {
-		cactusTwo++;
+	else if (replayMode == REPLAY_RECORD) {
+		eeprom_write_byte((uint8_t *)REPLAY_MAGIC_ADDRESS, REPLAY_END_OF_RUNS);
+		eeprom_write_word((uint16_t *)REPLAY_SEED_ADDRESS, randomState);
 	}
+	replayAddress = (uint8_t *)REPLAY_RUNS_START;
+	replayLeft = 0;
 }
 
-// Makes an pterodactyl active when it is displayed on the screen
-void checkPterodactyl() {
-	if (pteroOne == 0) {
-		pteroOne++;
+// Takes the inputs of one update step and returns the ones the step has to use
+// Recording passes them through and extends the current run, playback returns the recorded ones
+// A playback that runs out of recording ends the game
+uint8_t replayStep(uint8_t input) {
+	if (replayMode == REPLAY_PLAYBACK) {
+		if (replayLeft == 0) {
+			uint8_t run = (replayAddress < (uint8_t *)REPLAY_RUNS_END) ? eeprom_read_byte(replayAddress) : REPLAY_END_OF_RUNS;
+			if (run == REPLAY_END_OF_RUNS) {
+				gameOver = 1;
+				return input;
+			}
+			replayAddress++;
+			replayInput = run & ~REPLAY_LENGTH;
+			replayLeft = (run & REPLAY_LENGTH) + 1;
+		}
+		replayLeft--;
+		return replayInput;
 	}
-	else if (pteroTwo == 0) {
-		pteroTwo++;
+	if (replayMode == REPLAY_RECORD) {
+		if ((replayLeft == 0) || (input != replayInput) || (replayLeft > REPLAY_LENGTH)) {
+			replayFlush();
+			replayInput = input;
+		}
+		replayLeft++;
 	}
+	return input;
 }
 
-// Generates a random cactus or pterodactyl every 128 shifts
-void generateRandomEnemy() {
-	scrollCount++; // Increments every time the screen is shifted left
-	if (scrollCount == 128) {
-		int random_num = rand() % 2;
-		double scaled_num = random_num + 1; // Generates a random number either 1 or 2
-		// If random number is 1 draw a cactus on the screen and make it active
-		if (scaled_num == 1) {
-			drawCactus();
-			checkCactus();
+// Writes the finished run to EEPROM
+// A run only ends every few steps so the previous write has always completed by then
+// Recording stops where the EEPROM space does
+void replayFlush() {
+	if (replayLeft > 0) {
+		if (replayAddress < (uint8_t *)REPLAY_RUNS_END) {
+			eeprom_write_byte(replayAddress, replayInput | (replayLeft - 1));
+			replayAddress++;
 		}
-		// If random number is 2 draw a pterodactyl on the screen and make it active
-		else {
-			drawPterodactyl();
-			checkPterodactyl();
+		replayLeft = 0;
+	}
+}
+
+// Ends the recording of a game that is over and marks it as playable
+void replayFinish() {
+	if (replayMode == REPLAY_RECORD) {
+		replayFlush();
+		if (replayAddress < (uint8_t *)REPLAY_RUNS_END) {
+			eeprom_write_byte(replayAddress, REPLAY_END_OF_RUNS);
+		}
+		eeprom_write_byte((uint8_t *)REPLAY_MAGIC_ADDRESS, REPLAY_MAGIC);
+	}
+}
+
+// CRC of a high score slot, over every byte but the CRC itself
+uint8_t highScoreCRC(const uint8_t *slot) {
+	uint8_t crc = 0;
+	
+	for (uint8_t i = 0; i < HIGH_SCORE_SLOT_SIZE - 1; i++) {
+		crc = _crc8_ccitt_update(crc, slot[i]);
+	}
+	return crc;
+}
+
+// Reads the table from the newest slot whose CRC holds
+// An EEPROM that never held a table leaves every score at 0
+void highScoreLoad() {
+	uint8_t found = 0;
+	
+	for (uint8_t slot = 0; slot < HIGH_SCORE_SLOTS; slot++) {
+		uint8_t bytes[HIGH_SCORE_SLOT_SIZE];
+		const uint8_t *address = (const uint8_t *)HIGH_SCORE_START + slot * HIGH_SCORE_SLOT_SIZE;
+		for (uint8_t i = 0; i < HIGH_SCORE_SLOT_SIZE; i++) {
+			bytes[i] = eeprom_read_byte(address + i);
+		}
+		if (highScoreCRC(bytes) != bytes[HIGH_SCORE_SLOT_SIZE - 1]) {
+			continue;
+		}
+		// Sequence numbers wrap, a slot is newer when the newest so far is behind it
+		if (found && ((int8_t)(bytes[0] - highScoreSequence) <= 0)) {
+			continue;
 		}
-		scrollCount = 0;
+		found = 1;
+		highScoreSlot = slot;
+		highScoreSequence = bytes[0];
+		for (uint8_t i = 0; i < HIGH_SCORES; i++) {
+			highScores[i] = bytes[1 + 2 * i] | (bytes[2 + 2 * i] << 8);
+		}
+	}
+}
+
+// Puts the score of the game just ended into the table if it beat one there, and starts writing
+// the table to the next slot of the ring
+// A game played back from the replay was already counted when it was recorded
+void highScoreSubmit() {
+	uint16_t score = scoreBCD();
+	uint8_t rank = HIGH_SCORES;
+	
+	if (replayMode == REPLAY_PLAYBACK) {
+		return;
+	}
+	// BCD compares like the number it holds
+	while ((rank > 0) && (score > highScores[rank - 1])) {
+		rank--;
+	}
+	if (rank == HIGH_SCORES) {
+		return;
+	}
+	for (uint8_t i = HIGH_SCORES - 1; i > rank; i--) {
+		highScores[i] = highScores[i - 1];
+	}
+	highScores[rank] = score;
+	
+	// The slot may only change once the last save is all written
+	HAL_IDLE_WHILE(highScoreWritten < HIGH_SCORE_SLOT_SIZE);
+	highScoreSequence++;
+	highScoreSlot = (highScoreSlot + 1) % HIGH_SCORE_SLOTS;
+	highScoreBuffer[0] = highScoreSequence;
+	for (uint8_t i = 0; i < HIGH_SCORES; i++) {
+		highScoreBuffer[1 + 2 * i] = (uint8_t)highScores[i];
+		highScoreBuffer[2 + 2 * i] = (uint8_t)(highScores[i] >> 8);
+	}
+	highScoreBuffer[HIGH_SCORE_SLOT_SIZE - 1] = highScoreCRC(highScoreBuffer);
+	highScoreWritten = 0;
+	EECR |= (1 << EERIE);
+}
+
+// Writes the next byte of the slot being saved, the CRC goes last
+// Turns itself off once the slot is written
+ISR(EE_READY_vect) {
+	if (highScoreWritten < HIGH_SCORE_SLOT_SIZE) {
+		EEPROM_WRITE(HIGH_SCORE_START + highScoreSlot * HIGH_SCORE_SLOT_SIZE + highScoreWritten, highScoreBuffer[highScoreWritten]);
+		highScoreWritten++;
+	}
+	else {
+		EECR &= ~(1 << EERIE);
 	}
 }
 
@@ -409,1194 +899,995 @@ void Timer0Settings() {
 	TIMSK0 |= (1 << TOIE0);
 }
 
-// Triggered when the touch sensor is pressed
-ISR(INT1_vect) {
-	// Checks if the game is in its end state
-	if (resetCount > 0) {
-		// Toggles port to trigger reset
-		PORTC &= ~(0x04);
-		_delay_10ms();
-		PORTC |= 0x04;
-	}
+// Sets all the settings needed for Timer 1, the game tick
+void Timer1Settings() {
+	TCNT1 = 0x0000;
+	TCCR1A = 0x00;
+	// TCCR1B - Timer/Counter Control Register for Timer 1
+	// WGM12 - 1: Clear Timer on Compare match with OCR1A
+	// CS12 - 1, CS11 - 0, CS10 - 0: Prescale Timer by 256
+	TCCR1B = (1 << WGM12) | (1 << CS12);
+	OCR1A = (F_CPU / 256 / TICK_HZ) - 1;
+	TIMSK1 |= (1 << OCIE1A);
 }
 
-// Checks if the T-Rex has collided with any active objects constantly
-ISR(TIMER0_OVF_vect) {
-	collisionCheck();
+// Counts game ticks, the main loop consumes them in waitForTick()
+ISR(TIMER1_COMPA_vect) {
+	ticks++;
+	CLOCK_TICK();
 }
 
-
-// Creates a delay of 5 ms
-void _delay_5ms() {
-	unsigned char counter3 = 0;
-	while (counter3 != 5) {
-		_delay_loop_2(4000);
-		counter3++;
+// Idles until at least one tick has passed and returns how many ticks are owed to the world
+uint8_t waitForTick() {
+	cli();
+	while (ticks == 0) {
+		HAL_IDLE_SEI();
+		cli();
 	}
+	uint8_t owed = ticks;
+	ticks = 0;
+	sei();
+	return owed;
 }
 
-// Creates a delay of 10 ms
-void _delay_10ms() {
-	unsigned char counter3 = 0;
-	while (counter3 != 5) {
-		_delay_loop_2(8000);
-		counter3++;
+// Waits one tick on a screen that waits for the player
+// Once MENU_SLEEP_TICKS have gone by without a game the screen powers down
+void menuIdle() {
+	if (menuTicks < MENU_SLEEP_TICKS) {
+		menuTicks += waitForTick();
+		return;
 	}
+	powerDown();
+	menuTicks = 0;
 }
 
-// Initializes OLED display
-void oled_init() {
-	_delay_ms(100);
-	sendOneCommandByte(0xAE);
-	
-	sendTwoCommandByte(0xD5,0x80);
-	sendTwoCommandByte(0xA8,0x3F);
-	sendTwoCommandByte(0xD3,0x00);
-	sendOneCommandByte(0x40);
-	sendOneCommandByte(0xA1);
-	sendOneCommandByte(0xC8);
-	sendTwoCommandByte(0xDA,0x12);
-	sendTwoCommandByte(0x81,0x66);
-	sendTwoCommandByte(0xD9,0xF1);
-	sendTwoCommandByte(0xD8,0x30);
-	sendOneCommandByte(0xA4);
-	sendOneCommandByte(0xA6);
-	
-	sendTwoCommandByte(0x8D,0x14);
-	sendOneCommandByte(0xAF);
-	_delay_ms(100);
-	
-	sendTwoCommandByte(0x20,0x10);
-	
-	clearDisplay();
-	_delay_ms(1000);
-	
-}
-
-///////////////////////////////////////////////////////////////////////////////////////////////
-// Ducking animation for the T-Rex
-void duckingRex() {
-	duckingOne();
-	_delay_10ms();
-	duckingTwo();
-	_delay_10ms();
-	duckingThree();
-	_delay_10ms();
-	position(8,5);
-	for (int i = 0; i < 18; i++) {
-		sendData(0x00);
-	}
-	duckingFour();
-}
-
-// Animation to return T-Rex back to original state
-// Calls ducking animation backward with additional clearing
-void unduckingRex() {
-	position(25,6);
-	sendData(0x00);
-	duckingThree();
-	_delay_10ms();
-	position(24,5);
-	sendData(0x00);
-	position(24,6);
-	sendData(0x00);
-	duckingTwo();
-	_delay_10ms();
-	position(23,5);
-	sendData(0x00);
-	duckingOne();
-	_delay_10ms();
-	position(22,5);
-	sendData(0x00);
-	rexMode = 0;
-	drawRex();
-}
-
-// First frame of the ducking animation
-void duckingOne() {
-	rexMode = 25;
-	position(8,5);
-	sendData(0x80);
-	sendData(0x80);
-	sendData(0x00);
-	sendData(0x00);
-	sendData(0x00);
-	sendData(0x80);
-	sendData(0xC0);
-	sendData(0xC0);
-	sendData(0xC0);
-	sendData(0xF0);
-	sendData(0xF8);
-	sendData(0xE8);
-	sendData(0xB8);
-	sendData(0xB8);
-	sendData(0x30);
+// Turns the display and its charge pump off and powers the MCU down until the joystick button
+// or the touch sensor changes, then turns the display back on showing what it did before
+// Power-down stops every clock: the timers, the TWI, the ADC and the EEPROM interrupt all wait,
+// and only a pin change wakes the MCU
+void powerDown() {
+	uint8_t displayOff[3] = { 0xAE, 0x8D, 0x10 };
+	uint8_t displayOn[3] = { 0x8D, 0x14, 0xAF };
 	
-	position(8,6);
-	sendData(0x03);
-	sendData(0x03);
-	sendData(0x07);
-	sendData(0x07);
-	sendData(0xFF);
-	sendData(0xBF);
-	sendData(0x1F);
-	sendData(0x0F);
-	sendData(0x1F);
-	sendData(0xFF);
-	sendData(0x87);
-	sendData(0x02);
-	sendData(0x06);
-	sendData(0x00);
-	sendData(0x00);
-}
-
-// Second frame of the ducking animation
-void duckingTwo() {
-	rexMode = 26;
-	position(8,5);
-	sendData(0x00);
-	sendData(0x00);
-	sendData(0x00);
-	sendData(0x00);
-	sendData(0x00);
-	sendData(0x00);
-	sendData(0x80);
-	sendData(0x80);
-	sendData(0x80);
-	sendData(0x80);
-	sendData(0xE0);
-	sendData(0xF0);
-	sendData(0xD0);
-	sendData(0x70);
-	sendData(0x70);
-	sendData(0x60);
+	// The high score save needs EE_READY_vect, which cannot run while powered down
+	HAL_IDLE_WHILE(highScoreWritten < HIGH_SCORE_SLOT_SIZE);
+	queueCommands(displayOff, 3);
+	twiFence();
+	// The ISR is done once it has asked for the STOP, which is still on the bus until TWSTO clears
+	while (TWCR & (1 << TWSTO)) {
+	}
+	ADCSRA &= ~(1 << ADEN); // The ADC draws current even with nothing to convert
+	// A game lost mid jump leaves the LED lit and can leave a beep running
+	LED_OFF();
+	BUZZER_OFF();
 	
-	position(8,6);
-	sendData(0x0F);
-	sendData(0x0F);
-	sendData(0x0F);
-	sendData(0x0F);
-	sendData(0xFF);
-	sendData(0xBF);
-	sendData(0x1F);
-	sendData(0x0F);
-	sendData(0x1F);
-	sendData(0xFF);
-	sendData(0x87);
-	sendData(0x05);
-	sendData(0x0D);
-	sendData(0x01);
-	sendData(0x01);
-	sendData(0x00);
-}
-
-// Third frame of the ducking animation
-void duckingThree() {
-	rexMode = 27;
-	position(8,5);
-	sendData(0x00);
-	sendData(0x00);
-	sendData(0x00);
-	sendData(0x00);
-	sendData(0x00);
-	sendData(0x80);
-	sendData(0x80);
-	sendData(0x80);
-	sendData(0x80);
-	sendData(0x00);
-	sendData(0x00);
-	sendData(0x80);
-	sendData(0xC0);
-	sendData(0x40);
-	sendData(0xC0);
-	sendData(0xC0);
-	sendData(0x80);
+	PCMSK2 = STICK_PIN | TOUCH_PIN;
+	PCIFR = (1 << PCIF2);
+	PCICR |= (1 << PCIE2);
+	set_sleep_mode(SLEEP_MODE_PWR_DOWN);
+	cli();
+	sleep_enable();
+	sei(); // A pin change since cli() still wakes the sleep that follows
+	sleep_cpu();
+	sleep_disable();
+	set_sleep_mode(SLEEP_MODE_IDLE);
+	PCICR &= ~(1 << PCIE2);
+	PCMSK2 = 0;
 	
-	position(8,6);
-	sendData(0x1E);
-	sendData(0x1E);
-	sendData(0x0F);
-	sendData(0x0F);
-	sendData(0xFF);
-	sendData(0xBF);
-	sendData(0x1F);
-	sendData(0x0F);
-	sendData(0x1F);
-	sendData(0xFF);
-	sendData(0x87);
-	sendData(0x1F);
-	sendData(0x17);
-	sendData(0x07);
-	sendData(0x05);
-	sendData(0x05);
-	sendData(0x01);
-}
-
-// Fourth frame of the ducking animation
-void duckingFour() {
-	rexMode = 28;
-	
-	position(8,6);
-	sendData(0xF8);
-	sendData(0x7C);
-	sendData(0x3C);
-	sendData(0x1E);
-	sendData(0xFF);
-	sendData(0xBF);
-	sendData(0x1F);
-	sendData(0x0F);
-	sendData(0x1F);
-	sendData(0xFF);
-	sendData(0x8E);
-	sendData(0x3E);
-	sendData(0x2F);
-	sendData(0x0F);
-	sendData(0x1D);
-	sendData(0x17);
-	sendData(0x17);
-	sendData(0x06);
+	ADCSRA |= (1 << ADEN);
+	queueCommands(displayOn, 3);
+	twiFence();
+	// The press that woke the display does not start a game, the button has to be let go first
+	HAL_IDLE_WHILE(STICK_PRESSED());
+	cli();
+	buttonHistory = 0;
+	buttonDown = 0;
+	sei();
 }
 
-///////////////////////////////////////////////////////////////////////////////////////////////
-// Jumping and falling animation for the T-Rex
-// Continues the scrolling of the screen while in animation
-// Sets different mode for each frame it is in
-// First Eighth frames are repeated until the T-Rex has gone up 3 pages where it start to fall
-// Falling animation is done by calling the jumping animation backwards
-void jumpingRex() {
-	
-	jumpingOne(5,6);
-	rexMode = 1;
-	_delay_5ms();
-	scrollLeft();
-	preventScrollBack();
-	jumpingTwo(5,6);
-	rexMode = 2;
-	_delay_5ms();
-	scrollLeft();
-	preventScrollBack();
-	jumpingThree(4,5,6);
-	rexMode = 3;
-	_delay_5ms();
-	scrollLeft();
-	preventScrollBack();
-	jumpingFour(4,5,6);
-	rexMode = 4;
-	_delay_5ms();
-	scrollLeft();
-	preventScrollBack();
-	jumpingFive(4,5,6);
-	rexMode = 5;
-	_delay_5ms();
-	scrollLeft();
-	preventScrollBack();
-	jumpingSix(4,5,6);
-	rexMode = 6;
-	_delay_5ms();
-	scrollLeft();
-	preventScrollBack();
-	jumpingSeven(4,5,6);
-	rexMode = 7;
-	_delay_5ms();
-	scrollLeft();
-	preventScrollBack();
-	jumpingEight(4,5,6);
-	rexMode = 8;
-	_delay_5ms();
-	scrollLeft();
-	preventScrollBack();
-	
-	jumpingOne(4,5);
-	rexMode = 9;
-	_delay_5ms();
-	scrollLeft();
-	preventScrollBack();
-	jumpingTwo(4,5);
-	rexMode = 10;
-	_delay_5ms();
-	scrollLeft();
-	preventScrollBack();
-	jumpingThree(3,4,5);
-	rexMode = 11;
-	_delay_5ms();
-	scrollLeft();
-	preventScrollBack();
-	jumpingFour(3,4,5);
-	rexMode = 12;
-	_delay_5ms();
-	scrollLeft();
-	preventScrollBack();
-	jumpingFive(3,4,5);
-	rexMode = 13;
-	_delay_5ms();
-	scrollLeft();
-	preventScrollBack();
-	jumpingSix(3,4,5);
-	rexMode = 14;
-	_delay_5ms();
-	scrollLeft();
-	preventScrollBack();
-	jumpingSeven(3,4,5);
-	rexMode = 15;
-	_delay_5ms();
-	scrollLeft();
-	preventScrollBack();
-	jumpingEight(3,4,5);
-	rexMode = 16;
-	_delay_5ms();
-	scrollLeft();
-	preventScrollBack();
-	
-	jumpingOne(3,4);
-	rexMode = 17;
-	_delay_5ms();
-	scrollLeft();
-	preventScrollBack();
-	jumpingTwo(3,4);
-	rexMode = 18;
-	_delay_5ms();
-	scrollLeft();
-	preventScrollBack();
-	jumpingThree(2,3,4);
-	rexMode = 19;
-	_delay_5ms();
-	scrollLeft();
-	preventScrollBack();
-	jumpingFour(2,3,4);
-	rexMode = 20;
-	_delay_5ms();
-	scrollLeft();
-	preventScrollBack();
-	jumpingFive(2,3,4);
-	rexMode = 21;
-	_delay_5ms();
-	scrollLeft();
-	preventScrollBack();
-	jumpingSix(2,3,4);
-	rexMode = 22;
-	_delay_5ms();
-	scrollLeft();
-	preventScrollBack();
-	jumpingSeven(2,3,4);
-	rexMode = 23;
-	_delay_5ms();
-	scrollLeft();
-	preventScrollBack();
-	jumpingEight(2,3,4);
-	rexMode = 24;
-	//Falling
-	_delay_5ms();
-	scrollLeft();
-	preventScrollBack();
-	jumpingSeven(2,3,4);
-	rexMode = 23;
-	_delay_5ms();
-	scrollLeft();
-	preventScrollBack();
-	jumpingSix(2,3,4);
-	rexMode = 22;
-	_delay_5ms();
-	scrollLeft();
-	preventScrollBack();
-	jumpingFive(2,3,4);
-	rexMode = 21;
-	_delay_5ms();
-	scrollLeft();
-	preventScrollBack();
-	jumpingFour(2,3,4);
-	rexMode = 20;
-	_delay_5ms();
-	scrollLeft();
-	preventScrollBack();
-	jumpingThree(2,3,4);
-	rexMode = 19;
-	_delay_5ms();
-	scrollLeft();
-	preventScrollBack();
-	fallingClear(2);
-	jumpingTwo(3,4);
-	rexMode = 18;
-	_delay_5ms();
-	scrollLeft();
-	preventScrollBack();
-	jumpingOne(3,4);
-	rexMode = 17;
-	
-	_delay_5ms();
-	scrollLeft();
-	preventScrollBack();
-	jumpingEight(3,4,5);
-	rexMode = 16;
-	_delay_5ms();
-	scrollLeft();
-	preventScrollBack();
-	jumpingSeven(3,4,5);
-	rexMode = 15;
-	_delay_5ms();
-	scrollLeft();
-	preventScrollBack();
-	jumpingSix(3,4,5);
-	rexMode = 14;
-	_delay_5ms();
-	scrollLeft();
-	preventScrollBack();
-	jumpingFive(3,4,5);
-	rexMode = 13;
-	_delay_5ms();
-	scrollLeft();
-	preventScrollBack();
-	jumpingFour(3,4,5);
-	rexMode = 12;
-	_delay_5ms();
-	scrollLeft();
-	preventScrollBack();
-	jumpingThree(3,4,5);
-	rexMode = 11;
-	_delay_5ms();
-	scrollLeft();
-	preventScrollBack();
-	fallingClear(3);
-	jumpingTwo(4,5);
-	rexMode = 10;
-	_delay_5ms();
-	scrollLeft();
-	preventScrollBack();
-	jumpingOne(4,5);
-	rexMode = 9;
-	
-	_delay_5ms();
-	scrollLeft();
-	preventScrollBack();
-	jumpingEight(4,5,6);
-	rexMode = 8;
-	_delay_5ms();
-	scrollLeft();
-	preventScrollBack();
-	jumpingSeven(4,5,6);
-	rexMode = 7;
-	_delay_5ms();
-	scrollLeft();
-	preventScrollBack();
-	jumpingSix(4,5,6);
-	rexMode = 6;
-	_delay_5ms();
-	scrollLeft();
-	preventScrollBack();
-	jumpingFive(4,5,6);
-	rexMode = 5;
-	_delay_5ms();
-	scrollLeft();
-	preventScrollBack();
-	jumpingFour(4,5,6);
-	rexMode = 4;
-	_delay_5ms();
-	scrollLeft();
-	preventScrollBack();
-	jumpingThree(4,5,6);
-	rexMode = 3;
-	_delay_5ms();
-	scrollLeft();
-	preventScrollBack();
-	fallingClear(4);
-	jumpingTwo(5,6);
-	rexMode = 2;
-	_delay_5ms();
-	scrollLeft();
-	preventScrollBack();
-	jumpingOne(5,6);
-	rexMode = 1;
-	_delay_5ms();
-	scrollLeft();
-	preventScrollBack();
-	
-	drawRex();
-	rexMode = 0;
+// Only wakes the MCU from power-down, powerDown() carries on from there
+ISR(PCINT2_vect) {
 }
 
-// First frame of the jumping animation
-void jumpingOne(unsigned char top, unsigned char bottom) {
-	position(8,top);
-	//position(8,5);
-	for (int j = 0; j < 15; j++) {
-		if (j < 13) {
-			sendData((pgm_read_byte(&Rex[0][j]) >> 1) | 0x80);
-		}
-		else {
-			sendData((pgm_read_byte(&Rex[0][j]) >> 1));
-		}
-	}
-	position(8,bottom);
-	//position(8,6);
-	for (int j = 0; j < 15; j++) {
-		sendData(pgm_read_byte(&Rex[1][j]) >> 1);
+// Triggered when the touch sensor is pressed
+// Asks the main loop for the next game, the board is no longer reset for one
+ISR(INT1_vect) {
+	// Checks if the game is in its end state
+	if (resetCount > 0) {
+		restartRequested = 1;
 	}
 }
 
-// Second frame of the jumping animation
-void jumpingTwo(unsigned char top, unsigned char bottom) {
-	position(8,top);
-	//position(8,5);
-	for (int j = 0; j < 15; j++) {
-		if ((j < 11) || (j == 12)) {
-			sendData((pgm_read_byte(&Rex[0][j]) >> 2) | 0xC0);
-		}
-		else if (j == 11) {
-			sendData((pgm_read_byte(&Rex[0][j]) >> 2) | 0x40);
-		}
-		else {
-			sendData((pgm_read_byte(&Rex[0][j]) >> 2));
-		}
-	}
-	position(8,bottom);
-	//position(8,6);
-	for (int j = 0; j < 15; j++) {
-		sendData(pgm_read_byte(&Rex[1][j]) >> 2);
-	}
+// Only clears TOV0 on the way in, the ADC converts on its rising edge so the next overflow
+// can trigger the next joystick conversion
+ISR(TIMER0_OVF_vect) {
 }
 
-// Third frame of the jumping animation
-void jumpingThree(unsigned char top, unsigned char middle, unsigned char bottom) {
-	position(8,top);
-	for (int i = 0; i < 10; i++) {
-		sendData(0x00);
-	} 
-	//position(18,top);
-	//position(18,4);
-	for (int i = 0; i < 4; i++) {
-		sendData(0x80);
+
+// Initializes OLED display
+// Runs once at boot while the transfer queue is still empty, so it drives the bus itself:
+// the init table, one burst of zeros over the whole panel and the display on, in three transactions
+// The OLED does not acknowledge its address while it is still coming out of reset, which
+// i2c_start_wait() polls for instead of sleeping through a fixed delay; only once it answers
+// at the base rate is the bus raised to the fastest rate it keeps answering at
+// With no OLED on the bus the wait gives up and the game runs on, ISR(TWI_vect) drops every
+// transfer that is not acknowledged
+// The framebuffer starts zeroed and clean, which is what the panel shows afterwards
+void oled_init() {
+	if (i2c_start_wait(OLED_ADDRESS + I2C_WRITE)) {
+		return;
 	}
-	sendData(0x00);
-	
-	position(8,middle);
-	//position(8,5);
-	sendData(0x7C);
-	sendData(0xF8);
-	sendData(0xF0);
-	sendData(0xE0);
-	sendData(0xE0);
-	sendData(0xF0);
-	sendData(0xF8);
-	sendData(0xF8);
-	sendData(0xFC);
-	sendData(0xFF);
-	sendData(0xFF);
-	sendData(0x2E);
-	sendData(0x6B);
-	sendData(0x0B);
-	sendData(0x03);
-	
-	position(8,bottom);
-	//position(8,6);
-	for (int j = 0; j < 15; j++) {
-		sendData(pgm_read_byte(&Rex[1][j]) >> 3);
-	}
-}
-
-// Fourth frame of the jumping animation
-void jumpingFour(unsigned char top, unsigned char middle, unsigned char bottom) {
-	position(8,top);
-	for (int i = 0; i < 9; i++) {
-		sendData(0x00);
-	}
-	//position(17,top);
-	//position(17,4);
-	sendData(0x80);
-	sendData(0xC0);
-	sendData(0x40);
-	sendData(0xC0);
-	sendData(0xC0);
-	sendData(0x80);
-	
-	position(8,middle);
-	//position(8,5);
-	sendData(0x3E);
-	sendData(0x7C);
-	sendData(0x78);
-	sendData(0xF0);
-	sendData(0xF0);
-	sendData(0xF8);
-	sendData(0xFC);
-	sendData(0xFC);
-	sendData(0xFE);
-	sendData(0xFF);
-	sendData(0x7F);
-	sendData(0x17);
-	sendData(0x35);
-	sendData(0x05);
-	sendData(0x01);
-	
-	position(8,bottom);
-	//position(8,6);
-	for (int j = 0; j < 15; j++) {
-		sendData(pgm_read_byte(&Rex[1][j]) >> 4);
-	}
-}
-
-// Fifth frame of the jumping animation
-void jumpingFive(unsigned char top, unsigned char middle, unsigned char bottom) {
-	position(8,top);
-	for (int i = 0; i < 9; i++) {
-		sendData(0x00);
-	}
-	//position(17,top);
-	//position(17,4);
-	sendData(0xC0);
-	sendData(0xE0);
-	sendData(0xA0);
-	sendData(0xE0);
-	sendData(0xE0);
-	sendData(0xC0);
-	
-	position(8,middle);
-	//position(8,5);
-	sendData(0x1F);
-	sendData(0x3E);
-	sendData(0x3C);
-	sendData(0x78);
-	sendData(0xF8);
-	sendData(0xFC);
-	sendData(0xFE);
-	sendData(0x7E);
-	sendData(0xFF);
-	sendData(0xFF);
-	sendData(0x3F);
-	sendData(0x0B);
-	sendData(0x1A);
-	sendData(0x02);
-	sendData(0x00);
-	
-	position(8,bottom);
-	//position(8,6);
-	for (int j = 0; j < 15; j++) {
-		sendData(pgm_read_byte(&Rex[1][j]) >> 5);
-	}
-}
-
-// Sixth frame of the jumping animation
-void jumpingSix(unsigned char top, unsigned char middle, unsigned char bottom) {
-	position(8,top);
-	//position(8,4);
-	sendData(0x80);
-	sendData(0x00);
-	sendData(0x00);
-	sendData(0x00);
-	sendData(0x00);
-	sendData(0x00);
-	sendData(0x00);
-	sendData(0x00);
-	//position(16,top);
-	//position(16,4);
-	sendData(0x80);
-	sendData(0xE0);
-	sendData(0xF0);
-	sendData(0xD0);
-	sendData(0x70);
-	sendData(0x70);
-	sendData(0x60);
-	
-	position(8,middle);
-	//position(8,5);
-	sendData(0x0F);
-	sendData(0x1F);
-	sendData(0x1E);
-	sendData(0x3C);
-	sendData(0xFC);
-	sendData(0xFE);
-	sendData(0x7F);
-	sendData(0x3F);
-	sendData(0x7F);
-	sendData(0xFF);
-	sendData(0x1F);
-	sendData(0x05);
-	sendData(0x0D);
-	sendData(0x01);
-	sendData(0x00);
-	
-	position(8,bottom);
-	//position(8,6);
-	for (int j = 0; j < 15; j++) {
-		sendData(pgm_read_byte(&Rex[1][j]) >> 6);
-	}
-}
-
-// Seventh frame of the jumping animation
-void jumpingSeven(unsigned char top, unsigned char middle, unsigned char bottom) {
-	position(8,top);
-	//position(8,4);
-	sendData(0xC0);
-	sendData(0x80);
-	sendData(0x00);
-	sendData(0x00);
-	sendData(0x00);
-	sendData(0x00);
-	//position(14,top);
-	//position(14,4);
-	sendData(0x80);
-	sendData(0x80);
-	sendData(0xC0);
-	sendData(0xF0);
-	sendData(0xF8);
-	sendData(0xE8);
-	sendData(0xB8);
-	sendData(0xB8);
-	sendData(0x30);
+	i2c_stop();
+	i2c_probe_speed(OLED_ADDRESS);
 	
-	position(8,middle);
-	//position(8,5);
-	sendData(0x07);
-	sendData(0x0F);
-	sendData(0x0F);
-	sendData(0x1E);
-	sendData(0xFE);
-	sendData(0x7F);
-	sendData(0x3F);
-	sendData(0x1F);
-	sendData(0x3F);
-	sendData(0xFF);
-	sendData(0x0F);
-	sendData(0x02);
-	sendData(0x06);
-	sendData(0x00);
-	sendData(0x00);
+	i2c_start(OLED_ADDRESS + I2C_WRITE);
+	i2c_write(TWI_COMMANDS);
+	for (uint8_t i = 0; i < sizeof(OledInit); i++) {
+		i2c_write(pgm_read_byte(&OledInit[i]));
+	}
 	
-	position(8,bottom);
-	//position(8,6);
-	for (int j = 0; j < 15; j++) {
-		sendData(pgm_read_byte(&Rex[1][j]) >> 7);
+	// The panel holds random data after power up
+	i2c_rep_start(OLED_ADDRESS + I2C_WRITE);
+	i2c_write(TWI_DATA);
+	for (uint16_t i = 0; i < OLED_BYTES; i++) {
+		i2c_write(0x00);
 	}
+	
+	// Turned on only once it is blank, the charge pump settles while the title is drawn
+	i2c_rep_start(OLED_ADDRESS + I2C_WRITE);
+	i2c_write(TWI_COMMANDS);
+	i2c_write(0xAF);
+	i2c_stop();
 }
 
-// Eighth frame of the jumping animation
-void jumpingEight(unsigned char top, unsigned char middle, unsigned char bottom) {
-	position(8,top);
-	//position(8,4);
-	for (int j = 0; j < 15; j++) {
-		sendData(pgm_read_byte(&Rex[0][j]));
-	}
-	position(8,middle);
-	//position(8,5);
-	for (int j = 0; j < 15; j++) {
-		sendData(pgm_read_byte(&Rex[1][j]));
-	}
-	
-	
-	position(8,bottom);
-	//position(8,6);
-	for (int j = 0; j < 15; j++) {
-		sendData(pgm_read_byte(&Rex[1][j]) >> 8);
+///////////////////////////////////////////////////////////////////////////////////////////////
+// T-Rex animator
+// Runs once per tick from the update step: moves rexMode one step through the Keyframes table
+// for where the joystick is, so a jump or a duck never blocks the game loop and keeps pace with
+// the world when frames are skipped; renderPlayfield() draws the keyframe it ends on
+// A jump rises through modes 1 to 24 and falls back down them, tilting the stick down in the air
+// falls FAST_FALL modes per tick
+// A duck goes through modes 25 to 28, holds 28 while the stick is down and plays back to 25
+void animateRex(uint8_t stick) {
+	switch (rexState) {
+		case REX_RUNNING:
+			// Checking if the joystick is tilted up
+			if (stick == STICK_UP) {
+				LEDOn(); // Turn LED on
+				buzzerToggle(); // Sounds the buzzer shortly
+				rexState = REX_RISING;
+				rexMode = 1;
+			}
+			//Checking if the joystick is tilted down
+			else if (stick == STICK_DOWN) {
+				rexState = REX_DUCKING;
+				rexMode = 25;
+			}
+			else {
+				LEDOff(); // LED is off when joystick is in rest position
+			}
+			break;
+		case REX_RISING:
+			if (stick == STICK_DOWN) {
+				rexState = REX_FALLING;
+				fallRex(FAST_FALL);
+			}
+			else if (rexMode == JUMP_TOP) {
+				rexState = REX_FALLING;
+				rexMode--;
+			}
+			else {
+				rexMode++;
+			}
+			break;
+		case REX_FALLING:
+			fallRex((stick == STICK_DOWN) ? FAST_FALL : 1);
+			break;
+		case REX_DUCKING:
+			if (rexMode < 28) {
+				rexMode++;
+			}
+			// Checking when the joystick returns to rest position
+			else if (stick != STICK_DOWN) {
+				rexState = REX_UNDUCKING;
+				rexMode--;
+			}
+			break;
+		case REX_UNDUCKING:
+			if (rexMode == 25) {
+				rexState = REX_RUNNING;
+				rexMode = 0;
+			}
+			else {
+				rexMode--;
+			}
+			break;
 	}
-	
 }
 
-// Clears the top of the head of the T-Rex when it is falling
-void fallingClear(unsigned char page) {
-	position(18,page);
-	for (int i = 0; i < 4; i++) {
-		sendData(0x00);
+// Moves a falling T-Rex down by the given number of modes and lands it on the ground
+void fallRex(uint8_t modes) {
+	if (rexMode > modes) {
+		rexMode -= modes;
+	}
+	else {
+		rexState = REX_RUNNING;
+		rexMode = 0;
 	}
 }
 
 ///////////////////////////////////////////////////////////////////////////////////////////////
-// Shifts the screen one pixel to the left
+// Ends one frame of the game
+// Render: the frame that has just been drawn is queued for the panel
+// Update: the world moves scrollSpeed pixels left for every tick that has passed, ticks that
+// went by while a slow frame was being sent are stepped without being drawn (frame skip)
+// The next frame is then rendered in full, obstacles and the T-Rex, ready to be sent
 void scrollLeft() {
-	// Turns the scroll on the OLED on
-	sendOneCommandByte(0x2E);
-	sendOneCommandByte(0x27);
-	sendOneCommandByte(0x00);
-	sendOneCommandByte(0x05);
-	sendOneCommandByte(0x00); // Change scroll rate 0x04, 0x07
-	sendOneCommandByte(0x07);
-	sendOneCommandByte(0x00);
-	sendOneCommandByte(0xFF);
-	sendOneCommandByte(0x2F);
+	PROFILE_BEGIN(PROFILE_SEND);
+	sendFrame(); // Copies the finished frame out, the bus sends it while the next one is composed
+	PROFILE_END(PROFILE_SEND);
+	PROFILE_FRAME_END();
+	TELEMETRY_FRAME_END();
+	HAL_FRAME_END(); // Every tick of the game ends with one scroll
 	
-	_delay_ms(30);
-	sendOneCommandByte(0x2E); // Turns the scroll off
+	uint8_t steps = waitForTick();
+	if (steps > MAX_CATCH_UP) {
+		steps = MAX_CATCH_UP;
+	}
+	skippedFrames += steps - 1;
+	while ((steps > 0) && !gameOver) {
+		updateWorld();
+		steps--;
+	}
+	PROFILE_BEGIN(PROFILE_DRAW);
+	renderPlayfield();
+	PROFILE_END(PROFILE_DRAW);
+}
+
+// Moves the game forward by one tick
+void updateWorld() {
+	// A beep started by the last step has sounded for a whole tick, it is counted down before
+	// animateRex() can start the next one
+	if (buzzerTicks > 0) {
+		buzzerTicks--;
+		if (buzzerTicks == 0) {
+			BUZZER_OFF();
+		}
+	}
+	
+	// Whole pixels to move this tick, the fraction is kept for the next one
+	uint16_t travel = scrollFraction + scrollSpeed;
+	scrollStep = travel >> 8;
+	scrollFraction = travel & 0xFF;
+	
+	// Everything the step depends on from outside the game goes through the replay
+	PROFILE_BEGIN(PROFILE_INPUT);
+	uint8_t input = replayStep(stickState << REPLAY_STICK_SHIFT);
 	
-	resetCactus(); // Checks if the cactus has been cleared
-	resetPterodactyl(); // Checks if the pterodactyl has been cleared
-	activeCounter(); // Increments any active objects
-	generateRandomEnemy(); // Generates a random enemy every 128 shifts
+	animateRex(input >> REPLAY_STICK_SHIFT); // Moves the T-Rex one keyframe
+	PROFILE_END(PROFILE_INPUT);
+	PROFILE_BEGIN(PROFILE_OBSTACLES);
+	moveObstacles(); // Moves any active objects and clears the ones that have passed
+	scheduleObstacles(); // Sends a new obstacle when the gap since the last one has been covered
+	PROFILE_END(PROFILE_OBSTACLES);
+	groundOffset = (groundOffset + scrollStep) & 0x07; // Moves the ground along its ring
+	// Every step, a step that is caught up without being drawn can still end the game
+	PROFILE_BEGIN(PROFILE_COLLISION);
+	gameOver = collisionCheck();
+	PROFILE_END(PROFILE_COLLISION);
 }
 
-// Clears the first eight columns of the 5th and 6th page
-void preventScrollBack() {
-	position(0,5);
-	for (int i = 0; i < 8; i++) {
-		sendData(0x00);
+// Redraws the playfield from the world model: active obstacles and the current keyframe of the
+// T-Rex, lifted off the ground by its number of pixels, over an empty sky, then the ground
+// Pages 2 to 6 hold nothing but these sprites, so every byte of them is worked out in full from
+// the sprites over it before it is written and one that comes out as the panel shows it stays clean
+// Every sprite of the playfield lies within pages 2 to 6, so each layer unpacks row after row
+void renderPlayfield() {
+	Layer layers[MAX_OBSTACLES + 1];
+	uint8_t count = 0;
+	
+	for (uint8_t i = activeObstacles; i != NO_OBSTACLE; i = obstacleNext[i]) {
+		uint8_t sprite = pgm_read_byte(&ObstacleTypes[obstacleType[i]].sprite);
+		if ((obstacleX[i] < 128) && (obstacleX[i] + pgm_read_byte(&Sprites[sprite].width) > 0)) {
+			spriteLayer(&layers[count++], sprite, obstacleX[i], pgm_read_byte(&ObstacleTypes[obstacleType[i]].y));
+		}
 	}
-	position(0,6);
-	for (int i = 0; i < 8; i++) {
-		sendData(0x00);
+	spriteLayer(&layers[count++], pgm_read_byte(&Keyframes[rexMode].sprite), REX_X,
+		GROUND_Y - pgm_read_byte(&Keyframes[rexMode].lift));
+	
+	// Pages 2 to 6 follow each other, the sky the T-Rex jumps through, the high pterodactyls
+	// and the ground obstacles, so one run covers them
+	position(0,2);
+	for (uint8_t page = 2; page < 7; page++) {
+		// Columns of a row off the left edge are unpacked and dropped before the row starts
+		for (uint8_t i = 0; i < count; i++) {
+			if ((page >= layers[i].page) && (page < layers[i].page + layers[i].pages)) {
+				for (int16_t j = layers[i].x; j < 0; j++) {
+					unpackByte(&layers[i].bits);
+				}
+			}
+		}
+		for (int16_t x = 0; x < 128; x++) {
+			uint8_t column = 0x00;
+			for (uint8_t i = 0; i < count; i++) {
+				if ((page >= layers[i].page) && (page < layers[i].page + layers[i].pages) &&
+					(x >= layers[i].x) && (x < layers[i].x + layers[i].width)) {
+					column |= unpackByte(&layers[i].bits);
+				}
+			}
+			streamData(column);
+		}
+		// and the ones off the right edge once it is done
+		for (uint8_t i = 0; i < count; i++) {
+			if ((page >= layers[i].page) && (page < layers[i].page + layers[i].pages)) {
+				for (int16_t j = 128; j < layers[i].x + layers[i].width; j++) {
+					unpackByte(&layers[i].bits);
+				}
+			}
+		}
 	}
+	background();
 }
 
-// Displays a pterodactyl on the screen
-void drawPterodactyl() {
-	// Sends all the bytes required for a pterodactyl
-	position(115,5);
-	for (int j = 0; j < 11; j++) {
-		sendData(pgm_read_byte(&Pterodactyl[j]));
-	}
+// Sets a layer up to draw a sprite with its left edge at column x and its top at pixel row y
+void spriteLayer(Layer *layer, uint8_t sprite, int16_t x, uint8_t y) {
+	uint8_t shift = y & 0x07;
+	if (pgm_read_byte(&Sprites[sprite].shifts) == 1) {
+		shift = 0;
+	}
+	layer->bits.next = (const unsigned char *)pgm_read_ptr(&Sprites[sprite].atlas) + pgm_read_byte(&Sprites[sprite].offsets[shift]);
+	layer->bits.left = 0;
+	layer->bits.repeat = 0;
+	layer->x = x;
+	layer->width = pgm_read_byte(&Sprites[sprite].width);
+	layer->page = y >> 3;
+	// An unshifted sprite leaves its third page empty
+	layer->pages = (shift == 0) ? 2 : 3;
 }
 
-// Displays a cactus on the screen
-void drawCactus() {
-	// Sends all the bytes required for a cactus
-	position(121,5);
-	for (int j = 0; j < 6; j++) {
-		sendData(pgm_read_byte(&Cactus[0][j]));
-	}
-	position(121,6);
-	for (int j = 0; j < 6; j++) {
-		sendData(pgm_read_byte(&Cactus[1][j]));
+// Draws a sprite with its left edge at column x and its top at pixel row y
+// Bytes are ORed into the framebuffer so sprites can overlap, columns off either side are skipped
+void blitSprite(uint8_t sprite, int16_t x, uint8_t y) {
+	Layer layer;
+	spriteLayer(&layer, sprite, x, y);
+	int16_t first = (x < 0) ? -x : 0;
+	int16_t last = (x + layer.width > 128) ? 128 - x : layer.width;
+	
+	if (first >= last) {
+		return;
+	}
+	// The shift unpacks column by column, the ones off screen are unpacked and dropped
+	for (uint8_t page = 0; (page < layer.pages) && (layer.page + page < 8); page++) {
+		position(x + first, layer.page + page);
+		for (int16_t j = 0; j < layer.width; j++) {
+			uint8_t column = unpackByte(&layer.bits);
+			if ((j >= first) && (j < last)) {
+				streamData(frameBuffer[fbPage][fbColumn] | column);
+			}
+		}
 	}
 }
 
 // Displays a T-Rex on the screen
 void drawRex() {
-	// Sends all the bytes required for a T-Rex
-	position(8,5);
-	for (int j = 0; j < 15; j++) {
-		sendData(pgm_read_byte(&Rex[0][j]));
-	}
-	position(8,6);
-	for (int j = 0; j < 15; j++) {
-		sendData(pgm_read_byte(&Rex[1][j]));
-	}
+	blitSprite(SPRITE_REX, REX_X, GROUND_Y);
 }
 
 // Displays the background / floor on the screen
+// The 8 byte pattern is a ring, groundOffset picks which byte lands in the first column
 void background() {
 	position(0,7);
-	// Pattern for background repeated 16 times to fill the entirety of the 7th page
-	for (int i = 0; i < 16; i++) {
-		sendData(0xFE);
-		sendData(0xFD);
-		sendData(0xF7);
-		sendData(0xBF);
-		sendData(0xEF);
-		sendData(0xFB);
-		sendData(0x7F);
-		sendData(0xDF);
-	}	
+	for (int i = 0; i < 128; i++) {
+		streamData(pgm_read_byte(&Ground[(i + groundOffset) & 0x07]));
+	}
 }
 
 // Displays the start message asking user to press down on the joystick
 void gameStart() {
-	letterDisplay(0, 0); // P
-	letterDisplay(7, 1); // U
-	letterDisplay(14, 2); // S
-	letterDisplay(21, 3); // H
-	
-	letterDisplay(31, 2); // S
-	letterDisplay(38, 4); // T
-	letterDisplay(46, 6); // I
-	letterDisplay(54, 7); // C
-	letterDisplay(61, 8); // K
-	
-	letterDisplay(71, 4); // T
-	letterDisplay(79, 5); // O
-	
-	letterDisplay(89, 2); // S
-	letterDisplay(96, 4); // T
-	letterDisplay(104, 9); // A
-	letterDisplay(111, 10); // R
-	letterDisplay(118, 4); // T
+	drawText(0, 0, &FontLarge, PSTR("PUSH STICK TO START"));
 }
 
 // Displays the end message asking user to press down on touch sensor to reset the screen
 void gameEnd() {
-	letterDisplay(0, 0); // P
-	letterDisplay(7, 1); // U
-	letterDisplay(14, 2); // S
-	letterDisplay(21, 3); // H
-	
-	letterDisplay(30, 2); // S
-	letterDisplay(37, 11); // E
-	letterDisplay(44, 12); // N
-	letterDisplay(51, 2); // S
-	letterDisplay(58, 5); // O
-	letterDisplay(65, 10); // R
-	
-	letterDisplay(74, 4); // T
-	letterDisplay(82, 5); // O
-	
-	letterDisplay(92, 10); // R
-	letterDisplay(99, 11); // E
-	letterDisplay(106, 2); // S
-	letterDisplay(113, 11); // E
-	letterDisplay(120, 4); // T
-	
+	drawText(0, 0, &FontLarge, PSTR("PUSH SENSOR TO RESET"));
 }
 
-// Displays the final score the middle right of the screen when the game has ended
+// Displays the final score the middle right of the screen when the game has ended,
+// with the best score so far below it
 void displayFinalScore() {
-	position(64,3);
-	// S
-	for (int i = 0; i < 5; i++) {
-		sendData(pgm_read_byte(&scoreLetters[0][i]));
-	}
-	position(71,3);
-	// C
-	for (int i = 0; i < 5; i++) {
-		sendData(pgm_read_byte(&scoreLetters[1][i]));
-	}
-	position(78,3);
-	// O
-	for (int i = 0; i < 5; i++) {
-		sendData(pgm_read_byte(&scoreLetters[2][i]));
-	}
-	position(85,3);
-	// R
-	for (int i = 0; i < 5; i++) {
-		sendData(pgm_read_byte(&scoreLetters[3][i]));
-	}
-	position(92,3);
-	// E
-	for (int i = 0; i < 5; i++) {
-		sendData(pgm_read_byte(&scoreLetters[4][i]));
-	}
-	
-	position(99,3);
-	sendData(0x24); //colon
-	
-	int thousands = (int)score / 1000;
-	int temp = (int)score % 1000;
-	int hundreds = temp / 100;
-	temp = temp % 100;
-	int tens = temp / 10;
-	temp = temp % 10;
-	int ones = temp;
-	
-	position(102,3);
-	// Thousands number of the score
-	for (int i = 0; i < 4; i++) {
-		sendData(pgm_read_byte(&numbers[thousands][i]));
+	drawText(64, 3, &FontSmall, PSTR("SCORE:"));
+	drawText(64, 4, &FontSmall, PSTR("BEST:"));
+	// Thousands, hundreds, tens and ones of the score
+	for (uint8_t digit = 0; digit < SCORE_DIGITS; digit++) {
+		drawGlyph(FINAL_SCORE_X + digit * DIGIT_SPACING, 3, &FontSmall, '0' + scoreDigits[digit]);
+		drawGlyph(FINAL_SCORE_X + digit * DIGIT_SPACING, 4, &FontSmall, '0' + ((highScores[0] >> (12 - 4 * digit)) & 0x0F));
 	}
+}
+
+// Returns the score as four BCD digits, thousands in the top nibble
+uint16_t scoreBCD() {
+	uint16_t score = 0;
 	
-	position(108,3);
-	// Hundreds number of the score
-	for (int i = 0; i < 4; i++) {
-		sendData(pgm_read_byte(&numbers[hundreds][i]));
+	for (uint8_t digit = 0; digit < SCORE_DIGITS; digit++) {
+		score = (score << 4) | scoreDigits[digit];
 	}
+	return score;
+}
+
+// Adds a point to the score
+// The ones digit goes up and every 9 it passes carries into the digit on its left,
+// each digit that changed is redrawn and the rest of the score is left alone
+void scorePoint() {
+	uint8_t digit = SCORE_DIGITS;
 	
-	position(114,3);
-	// Tens number of the score
-	for (int i = 0; i < 4; i++) {
-		sendData(pgm_read_byte(&numbers[tens][i]));
+	PROFILE_BEGIN(PROFILE_SCORE);
+	while (digit > 0) {
+		digit--;
+		if (scoreDigits[digit] < 9) {
+			scoreDigits[digit]++;
+			displayNumber(scoreDigits[digit], SCORE_X + digit * DIGIT_SPACING);
+			break;
+		}
+		scoreDigits[digit] = 0;
+		displayNumber(0, SCORE_X + digit * DIGIT_SPACING);
 	}
+	PROFILE_END(PROFILE_SCORE);
+}
+
+// Displays a number to the screen at a certain position
+void displayNumber(int number, int x) {
+	drawGlyph(x, 0, &FontSmall, '0' + number);
+}
+
+// Displays the score text to the screen, the digits follow it from SCORE_X
+void drawScore() {
+	drawText(0, 0, &FontSmall, PSTR("SCORE:"));
+}
+
+// Returns the next byte of a glyph's bitmap or a sprite's shift
+// A byte below 0x80 starts a run of that many plus one bytes to copy, any other repeats the
+// byte after it that many less 0x80 plus two times
+uint8_t unpackByte(Unpacker *bits) {
+	if (bits->left == 0) {
+		uint8_t header = pgm_read_byte(bits->next++);
+		bits->repeat = header & 0x80;
+		bits->left = bits->repeat ? (header - 0x80 + 2) : (header + 1);
+	}
+	uint8_t value = pgm_read_byte(bits->next);
+	bits->left--;
+	if (!bits->repeat || (bits->left == 0)) {
+		bits->next++;
+	}
+	return value;
+}
+
+// Draws one character at column x with its top on page, returns the columns it took
+// including the spacing after it, or 0 if the font has no such glyph or it does not fit
+uint8_t drawGlyph(uint8_t x, uint8_t page, const Font *font, char code) {
+	const Glyph *glyph = (const Glyph *)pgm_read_ptr(&font->glyphs);
+	uint8_t count = pgm_read_byte(&font->count);
 	
-	position(120,3);
-	// Ones number of the score
-	for (int i = 0; i < 4; i++) {
-		sendData(pgm_read_byte(&numbers[ones][i]));
+	while ((count > 0) && ((char)pgm_read_byte(&glyph->code) != code)) {
+		glyph++;
+		count--;
+	}
+	if (count == 0) {
+		return 0;
+	}
+	uint8_t width = pgm_read_byte(&glyph->width);
+	uint8_t pages = pgm_read_byte(&font->pages);
+	if ((x + width > 128) || (page + pages > 8)) {
+		return 0;
+	}
+	// An unpacked font is one endless copy run, a glyph never needs a header
+	Unpacker bits = {
+		(const unsigned char *)pgm_read_ptr(&font->bitmaps) + pgm_read_byte(&glyph->offset),
+		pgm_read_byte(&font->packed) ? 0 : 0xFF,
+		0
+	};
+	for (uint8_t p = 0; p < pages; p++) {
+		position(x, page + p);
+		for (uint8_t i = 0; i < width; i++) {
+			streamData(unpackByte(&bits));
+		}
 	}
-	
+	return width + pgm_read_byte(&font->spacing);
 }
 
-// Displays the current score to the screen
-void displayScore() {
-	// Grabs the current score from the score count
-	// Extracts the Thousands, Hundreds, Tens, and Ones place
-	int thousands = (int)score / 1000;
-	int temp = (int)score % 1000;
-	int hundreds = temp / 100;
-	temp = temp % 100;
-	int tens = temp / 10;
-	temp = temp % 10;
-	int ones = temp;
+// Draws a PROGMEM string left to right from column x, returns the column after it
+// Characters the font has no glyph for are skipped
+uint8_t drawText(uint8_t x, uint8_t page, const Font *font, const char *text) {
+	char code;
 	
-	// Displays any numbers that have changed to the screen
-	if (lastThousands != thousands) {
-		displayNumber(thousands, 38);
-		lastThousands = thousands;
-	}
-	if (lastHundreds != hundreds) {
-		displayNumber(hundreds, 44);
-		lastHundreds = hundreds;
+	while ((code = pgm_read_byte(text++)) != '\0') {
+		x += drawGlyph(x, page, font, code);
 	}
-	if (lastTens != tens) {
-		displayNumber(tens, 50);
-		lastTens = tens;
+	return x;
+}
+
+// Writes the next data byte at the cursor, it reaches the panel on the next flush()
+// Logic 1 turns a pixel on the display on
+void streamData(unsigned char data) {
+	// Only a byte that differs from what the panel shows needs to be sent
+	if (frameBuffer[fbPage][fbColumn] != data) {
+		frameBuffer[fbPage][fbColumn] = data;
+		if (fbColumn < dirtyStart[fbPage]) {
+			dirtyStart[fbPage] = fbColumn;
+		}
+		if ((fbColumn > dirtyEnd[fbPage]) || (dirtyEnd[fbPage] == CLEAN)) {
+			dirtyEnd[fbPage] = fbColumn;
+		}
 	}
-	if (lastOnes != ones) {
-		displayNumber(ones, 56);
-		lastOnes = ones;
+	// Advances like the panel in horizontal addressing mode
+	fbColumn++;
+	if (fbColumn == 128) {
+		fbColumn = 0;
+		fbPage = (fbPage + 1) & 0x07;
 	}
-	
 }
 
-// Displays a number to the screen at a certain position
-void displayNumber(int number, int x) {
-	position(x,0);
-	for (int i = 0; i < 4; i++) {
-		sendData(pgm_read_byte(&numbers[number][i]));
+// Sets the position of the cursor in the framebuffer
+void position(unsigned char x, unsigned char y) {
+	fbColumn = x & 0x7F;
+	fbPage = y & 0x07;
+}
+
+// Sets the panel window the next data bytes fill
+// In horizontal addressing mode the panel walks the columns of a page and wraps to the first
+// column of the next page, so a multi-page block needs no further commands
+// Both ranges go in one command transaction instead of three cursor commands per page
+void panelWindow(uint8_t firstColumn, uint8_t lastColumn, uint8_t firstPage, uint8_t lastPage) {
+	uint8_t commands[6] = { 0x21, firstColumn, lastColumn, 0x22, firstPage, lastPage };
+	queueCommands(commands, 6);
+}
+
+// Copies every changed column range of the framebuffer into txBuffer, queues it and returns
+// Dirty pages are grouped into one window when resending the columns between their spans
+// costs fewer bus bytes than a window of their own, so a sprite across two or three pages
+// goes out as one command write and one data burst
+void sendFrame() {
+	uint8_t page = 0;
+	
+	while (page < 8) {
+		if (dirtyStart[page] == CLEAN) {
+			page++;
+			continue;
+		}
+		uint8_t firstPage = page;
+		uint8_t lastPage = page;
+		uint8_t firstColumn = dirtyStart[page];
+		uint8_t lastColumn = dirtyEnd[page];
+		
+		for (uint8_t next = page + 1; next < 8; next++) {
+			if (dirtyStart[next] == CLEAN) {
+				continue;
+			}
+			uint8_t mergedFirst = (dirtyStart[next] < firstColumn) ? dirtyStart[next] : firstColumn;
+			uint8_t mergedLast = (dirtyEnd[next] > lastColumn) ? dirtyEnd[next] : lastColumn;
+			uint16_t merged = (uint16_t)(mergedLast - mergedFirst + 1) * (next - firstPage + 1);
+			uint16_t apart = (uint16_t)(lastColumn - firstColumn + 1) * (lastPage - firstPage + 1)
+				+ WINDOW_COST + (dirtyEnd[next] - dirtyStart[next] + 1);
+			if (merged > apart) {
+				break;
+			}
+			lastPage = next;
+			firstColumn = mergedFirst;
+			lastColumn = mergedLast;
+		}
+		
+		panelWindow(firstColumn, lastColumn, firstPage, lastPage);
+		queueWindow(firstColumn, lastColumn, firstPage, lastPage);
+		for (page = firstPage; page <= lastPage; page++) {
+			dirtyStart[page] = CLEAN;
+			dirtyEnd[page] = CLEAN;
+		}
 	}
 }
 
-// Displays the score text to the screen
-void drawScore() {
-	position(0,0);
-	// S
-	for (int i = 0; i < 5; i++) {
-		sendData(pgm_read_byte(&scoreLetters[0][i]));
-	}
-	position(7,0);
-	// R
-	for (int i = 0; i < 5; i++) {
-		sendData(pgm_read_byte(&scoreLetters[1][i]));
-	}
-	position(14,0);
-	// O
-	for (int i = 0; i < 5; i++) {
-		sendData(pgm_read_byte(&scoreLetters[2][i]));
-	}
-	position(21,0);
-	// R
-	for (int i = 0; i < 5; i++) {
-		sendData(pgm_read_byte(&scoreLetters[3][i]));
-	}
-	position(28,0);
-	// E
-	for (int i = 0; i < 5; i++) {
-		sendData(pgm_read_byte(&scoreLetters[4][i]));
+// Sends every changed column range of the framebuffer and waits until the panel has it all
+void flush() {
+	sendFrame();
+	twiFence();
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////
+// Display transfers
+
+// Takes the next free entry of the ring, waiting for the ISR to free one if they are all queued
+TwiTransfer *nextTransfer() {
+	HAL_IDLE_WHILE(((twiHead + 1) & (TWI_QUEUE_SIZE - 1)) == twiTail);
+	return &twiQueue[twiHead];
+}
+
+// Hands the entry taken by nextTransfer() to the ISR and starts the bus if it was idle
+void commitTransfer() {
+	PROFILE_TRANSFER(twiQueue[twiHead].length);
+	TELEMETRY_TRANSFER(twiQueue[twiHead].length);
+	cli();
+	twiHead = (twiHead + 1) & (TWI_QUEUE_SIZE - 1);
+	if (!twiBusy) {
+		twiBusy = 1;
+		// A STOP sent by the ISR has to finish before the next START
+		while (TWCR & (1 << TWSTO)) {
+		}
+		TWI_COMMAND((1 << TWINT) | (1 << TWSTA) | (1 << TWEN) | (1 << TWIE));
 	}
-	
-	position(35,0);
-	sendData(0x24); //colon
+	sei();
 }
 
-// Displays a two page letter to the screen a certain location on the first two pages 
-void letterDisplay(uint8_t x, uint8_t index) {
-	position(x,0);
-	for (int i = 0; i < 7; i++) {
-		sendData(pgm_read_byte(&Letters[index][i]));
+// Queues one command transaction of up to TWI_COMMAND_BYTES commands
+void queueCommands(const uint8_t *commands, uint8_t length) {
+	TwiTransfer *transfer = nextTransfer();
+	transfer->control = TWI_COMMANDS;
+	transfer->length = length;
+	for (uint8_t i = 0; i < length; i++) {
+		transfer->commands[i] = commands[i];
 	}
-	position(x,1);
-	for (int i = 7; i < 14; i++) {
-		sendData(pgm_read_byte(&Letters[index][i]));
+	commitTransfer();
+}
+
+// Copies a window of the framebuffer into txBuffer row by row and queues it as data
+// The panel keeps its place in the window between transactions, so a window longer than
+// TX_CHUNK is simply split into several
+void queueWindow(uint8_t firstColumn, uint8_t lastColumn, uint8_t firstPage, uint8_t lastPage) {
+	uint8_t width = lastColumn - firstColumn + 1;
+	uint16_t chunk = 0;
+	
+	for (uint8_t page = firstPage; page <= lastPage; page++) {
+		if (chunk + width > TX_CHUNK) {
+			queueData(chunk);
+			chunk = 0;
+		}
+		HAL_IDLE_WHILE(txFree() < width);
+		for (uint8_t x = firstColumn; x <= lastColumn; x++) {
+			txBuffer[txHead] = frameBuffer[page][x];
+			txHead = (txHead + 1) & (TX_BUFFER_SIZE - 1);
+		}
+		chunk += width;
 	}
+	queueData(chunk);
 }
 
-// Sends one command byte to the screen
-void sendOneCommandByte(unsigned char cmd) {
-	i2c_start((unsigned char)0x78 + I2C_WRITE);
-	i2c_write(0x00);
-	i2c_write(cmd);
-	i2c_stop(); 
+// Queues one data transaction for the last length bytes copied into txBuffer
+void queueData(uint16_t length) {
+	TwiTransfer *transfer = nextTransfer();
+	transfer->control = TWI_DATA;
+	transfer->length = length;
+	commitTransfer();
 }
 
-// Sends two command bytes to the screen
-void sendTwoCommandByte(unsigned char cmdOne, unsigned char cmdTwo) {
-	i2c_start((unsigned char)0x78 + I2C_WRITE);
-	i2c_write(0x00);
-	i2c_write(cmdOne);
-	i2c_write(cmdTwo);
-	i2c_stop();
+// Returns how many bytes can be copied into txBuffer before it would overwrite unsent ones
+// Called with interrupts off, the ISR moves txTail
+uint16_t txFree() {
+	uint16_t queued = (txHead - txTail) & (TX_BUFFER_SIZE - 1);
+	return TX_BUFFER_SIZE - 1 - queued;
 }
 
-// Sends one data byte to the screen
-// Logic 1 turns a pixel on the display on
-void sendData(unsigned char data) {
-	i2c_start((unsigned char)0x78 + I2C_WRITE);
-	i2c_write(0x40);
-	i2c_write(data);
-	i2c_stop();
+// Waits until every queued transaction is on the panel
+void twiFence() {
+	HAL_IDLE_WHILE(twiBusy);
 }
 
-// Sets the position of the cursor on the display
-void position(unsigned char x, unsigned char y) {
-	sendOneCommandByte(0x00 + (x & 0x0F));
-	sendOneCommandByte(0x10 + ((x >> 4) & 0x0F));
-	sendOneCommandByte(0xB0 + y);
+// Runs after every START, address byte and data byte the TWI hardware has finished
+// Walks the entry at the tail of the ring one byte at a time, then sends a STOP and either
+// a START for the next entry or nothing when the ring is empty
+ISR(TWI_vect) {
+	TwiTransfer *transfer = &twiQueue[twiTail];
+	
+	switch (TW_STATUS) {
+		case TW_START:
+		case TW_REP_START:
+			TWDR = OLED_ADDRESS + I2C_WRITE;
+			twiSent = 0;
+			TWI_COMMAND((1 << TWINT) | (1 << TWEN) | (1 << TWIE));
+			return;
+		case TW_MT_SLA_ACK:
+			TWDR = transfer->control;
+			TWI_COMMAND((1 << TWINT) | (1 << TWEN) | (1 << TWIE));
+			return;
+		case TW_MT_DATA_ACK:
+			if (twiSent < transfer->length) {
+				if (transfer->control == TWI_COMMANDS) {
+					TWDR = transfer->commands[twiSent];
+				}
+				else {
+					TWDR = txBuffer[txTail];
+					txTail = (txTail + 1) & (TX_BUFFER_SIZE - 1);
+				}
+				twiSent++;
+				TWI_COMMAND((1 << TWINT) | (1 << TWEN) | (1 << TWIE));
+				return;
+			}
+			break; // Every byte of the entry has been sent
+		default:
+			// The OLED did not acknowledge, the entry is dropped rather than retried
+			// and whatever it still had in txBuffer is skipped with it
+			if (transfer->control == TWI_DATA) {
+				txTail = (txTail + transfer->length - twiSent) & (TX_BUFFER_SIZE - 1);
+			}
+			twiErrors++;
+			break;
+	}
+	
+	twiTail = (twiTail + 1) & (TWI_QUEUE_SIZE - 1);
+	if (twiTail != twiHead) {
+		// STOP followed straight away by the START of the next entry
+		TWI_COMMAND((1 << TWINT) | (1 << TWSTO) | (1 << TWSTA) | (1 << TWEN) | (1 << TWIE));
+	}
+	else {
+		TWI_COMMAND((1 << TWINT) | (1 << TWSTO) | (1 << TWEN));
+		twiBusy = 0;
+	}
 }
 
 // Clears the top two pages of the display
 void clearTopTwoPages() {
 	position(0,0);
 	for (int j = 0; j < 128; j++) {
-		sendData(0x00);
+		streamData(0x00);
 	}
 	position(0,1);
 	for (int j = 0; j < 128; j++) {
-		sendData(0x00);
+		streamData(0x00);
 	}
 }
 
-// Clears the entire display
-void clearDisplay() {
-	position(0,0);
-	for (int i = 0; i < 8; i++) {
-		for (int j = 0; j < 128; j++) {
-			sendData(0x00);
+#ifdef INSTRUMENTED
+///////////////////////////////////////////////////////////////////////////////////////////////
+// Instrumentation
+
+// Sets the UART up: 115200 baud 8N1 at double speed, the transmitter is fed by its interrupt
+void uartInit() {
+	UBRR0 = (F_CPU / 8 / UART_BAUD) - 1;
+	UCSR0A |= (1 << U2X0);
+	UCSR0B = (1 << RXEN0) | (1 << TXEN0);
+	UCSR0C = (1 << UCSZ01) | (1 << UCSZ00);
+}
+
+// Moves the next byte of the ring into the transmitter and stops once the ring is empty
+ISR(USART_UDRE_vect) {
+	UART_WRITE(uartBuffer[uartTail]);
+	uartTail = (uartTail + 1) & (UART_BUFFER_SIZE - 1);
+	if (uartTail == uartHead) {
+		UCSR0B &= ~(1 << UDRIE0);
+	}
+}
+
+// Returns how many bytes fit in the UART ring
+uint8_t uartFree() {
+	return (uartTail - uartHead - 1) & (UART_BUFFER_SIZE - 1);
+}
+
+// Queues all of the bytes on the UART, or none of them if they do not fit
+// Returns whether they were queued
+uint8_t uartWrite(const uint8_t *bytes, uint8_t length) {
+	if (uartFree() < length) {
+		return 0;
+	}
+	for (uint8_t i = 0; i < length; i++) {
+		uartBuffer[uartHead] = bytes[i];
+		uartHead = (uartHead + 1) & (UART_BUFFER_SIZE - 1);
+	}
+	UCSR0B |= (1 << UDRIE0);
+	return 1;
+}
+
+// Sends a string over the UART, waiting for room in the ring
+void uartPrint(const char *text) {
+	while (*text) {
+		HAL_IDLE_WHILE(uartFree() == 0);
+		uartWrite((const uint8_t *)text++, 1);
+	}
+}
+
+// Returns the time in Timer 1 counts since the game tick started
+uint32_t timerClock() {
+	uint16_t ticks;
+	return timerClockTicks(&ticks);
+}
+
+// Returns the time like timerClock() and the ticks it holds, both read at the same moment
+// A compare match that happened while interrupts were off is counted from its flag
+uint32_t timerClockTicks(uint16_t *ticks) {
+	cli();
+	uint16_t count = TCNT1;
+	uint16_t elapsed = clockTicks;
+	if (TIFR1 & (1 << OCF1A)) {
+		count = TCNT1;
+		elapsed++;
+	}
+	sei();
+	*ticks = elapsed;
+	return (uint32_t)elapsed * (OCR1A + 1) + count;
+}
+#endif
+
+#ifdef PROFILE
+///////////////////////////////////////////////////////////////////////////////////////////////
+// Profiling
+
+// Keeps the figures of the frame that has just been sent and starts the next one
+// A byte waiting on the UART asks for a dump
+void profileFrameEnd() {
+	profileFrames[profileHead] = profileCurrent;
+	profileHead = (profileHead + 1) & (PROFILE_FRAMES - 1);
+	if (profileCount < PROFILE_FRAMES) {
+		profileCount++;
+	}
+	memset(&profileCurrent, 0, sizeof(profileCurrent));
+	
+	if (UCSR0A & (1 << RXC0)) {
+		(void)UDR0;
+		profileDump();
+	}
+}
+
+// Prints the min/avg/max of every phase in microseconds and of the display traffic over
+// the frames that are kept
+void profileDump() {
+	static const char names[PROFILE_PHASES + 2][12] PROGMEM = {
+		"input", "collision", "obstacles", "score", "draw", "send", "transfers", "bytes"
+	};
+	char line[48];
+	
+	if (profileCount == 0) {
+		return;
+	}
+	snprintf_P(line, sizeof(line), PSTR("profile %u frames, us\r\n"), profileCount);
+	uartPrint(line);
+	for (uint8_t row = 0; row < PROFILE_PHASES + 2; row++) {
+		uint16_t low = 0xFFFF;
+		uint16_t high = 0;
+		uint32_t sum = 0;
+		for (uint8_t i = 0; i < profileCount; i++) {
+			uint16_t value;
+			if (row < PROFILE_PHASES) {
+				value = profileFrames[i].time[row];
+			}
+			else if (row == PROFILE_PHASES) {
+				value = profileFrames[i].transactions;
+			}
+			else {
+				value = profileFrames[i].bytes;
+			}
+			low = (value < low) ? value : low;
+			high = (value > high) ? value : high;
+			sum += value;
 		}
+		// Timer 1 counts at F_CPU / 256
+		uint32_t scale = (row < PROFILE_PHASES) ? 256000000UL / (F_CPU / 1000) : 1000;
+		char name[12];
+		strcpy_P(name, names[row]);
+		snprintf_P(line, sizeof(line), PSTR("%-10s %6lu %6lu %6lu\r\n"), name, (unsigned long)(low * scale / 1000),
+			(unsigned long)(sum * scale / profileCount / 1000), (unsigned long)(high * scale / 1000));
+		uartPrint(line);
+	}
+	snprintf_P(line, sizeof(line), PSTR("skipped    %u frames this game\r\n"), skippedFrames);
+	uartPrint(line);
+	cli();
+	uint16_t errors = twiErrors;
+	sei();
+	snprintf_P(line, sizeof(line), PSTR("dropped    %u transfers since power on\r\n"), errors);
+	uartPrint(line);
+}
+
+#endif
+
+#ifdef TELEMETRY
+///////////////////////////////////////////////////////////////////////////////////////////////
+// Telemetry
+
+// Sends the record of the frame that has just been sent, or counts it as dropped
+void telemetryFrameEnd() {
+	uint16_t ticks; // The ISR moves clockTicks, a read of it here could tear between its bytes
+	uint32_t now = timerClockTicks(&ticks);
+	uint32_t frameTime = now - telemetryStart;
+	uint8_t obstacles = 0;
+	uint8_t record[TELEMETRY_RECORD];
+	uint8_t sum = 0;
+	
+	if (frameTime > 0xFFFF) {
+		frameTime = 0xFFFF;
+	}
+	for (uint8_t i = activeObstacles; i != NO_OBSTACLE; i = obstacleNext[i]) {
+		obstacles++;
+	}
+	record[0] = TELEMETRY_SYNC;
+	record[1] = (uint8_t)ticks;
+	record[2] = (uint8_t)(ticks >> 8);
+	record[3] = (uint8_t)frameTime;
+	record[4] = (uint8_t)(frameTime >> 8);
+	record[5] = (uint8_t)telemetryBytes;
+	record[6] = (uint8_t)(telemetryBytes >> 8);
+	record[7] = obstacles;
+	record[8] = rexMode;
+	uint16_t score = scoreBCD();
+	record[9] = (uint8_t)score;
+	record[10] = (uint8_t)(score >> 8);
+	record[11] = telemetryDropped;
+	for (uint8_t i = 1; i < TELEMETRY_RECORD - 1; i++) {
+		sum += record[i];
+	}
+	record[TELEMETRY_RECORD - 1] = sum;
+	
+	if (uartWrite(record, TELEMETRY_RECORD)) {
+		telemetryDropped = 0;
+	}
+	else if (telemetryDropped < 0xFF) {
+		telemetryDropped++;
 	}
+	telemetryStart = now;
+	telemetryBytes = 0;
 }
+#endif
 
 ///////////////////////////////////////////////////////////////////////////////////////////////
 // Initializes the ADC
 void ADCint(void) {
-	// ADC Clock frequency: >200.000 kHz.
-	// ADC Voltage Reference: AVCC pin.
-	// ADC Auto Trigger Source: Free Running.
+	// ADC Clock frequency: 125 kHz.
+	// ADC Voltage Reference: AVCC pin, joystick on ADC0.
+	// ADC Auto Trigger Source: Timer/Counter0 Overflow, one conversion every 16 ms.
 	#define ADC_VREF_TYPE ((0<<REFS1) | (1<<REFS0) | (0<<ADLAR));
 	ADMUX = ADC_VREF_TYPE;
 	ADCSRA = (1<<ADEN)|(0<<ADSC)|(1<<ADATE)|(0<<ADIF);
-	ADCSRA = ADCSRA |(0<<ADIE)|(1<<ADPS2)|(1<<ADPS1)|(1<<ADPS0); //scaling factor 128 so freq = 50-200kHz
-	ADCSRB=(0<<ADTS2)|(0<<ADTS1)|(0<<ADTS0);
-}
-
-// Creates a delay of 10 microseconds
-void _delay_10us(void) {
-	_delay_loop_2(40);
+	ADCSRA = ADCSRA |(1<<ADIE)|(1<<ADPS2)|(1<<ADPS1)|(1<<ADPS0); //scaling factor 128 so freq = 50-200kHz
+	ADCSRB=(1<<ADTS2)|(0<<ADTS1)|(0<<ADTS0);
 }
 
-// Creates a delay of 1 second
-void _delay_1s(void) {
-	unsigned char counter = 0;
-	while (counter != 80) {
-		_delay_loop_2(50000);
-		counter++;
+// Runs after every joystick conversion
+// Sorts the reading into a stick position with hysteresis and debounces the push button
+ISR(ADC_vect) {
+	uint16_t reading = ADCW;
+	
+	if (((stickState == STICK_UP) && (reading > STICK_UP_LEAVE)) ||
+		((stickState == STICK_DOWN) && (reading < STICK_DOWN_LEAVE))) {
+		stickState = STICK_REST;
+	}
+	if (stickState == STICK_REST) {
+		if (reading < STICK_UP_ENTER) {
+			stickState = STICK_UP;
+		}
+		else if (reading > STICK_DOWN_ENTER) {
+			stickState = STICK_DOWN;
+		}
+	}
+	
+	buttonHistory = (buttonHistory << 1) | (STICK_PRESSED() ? 1 : 0);
+	if ((buttonHistory & BUTTON_SAMPLES) == BUTTON_SAMPLES) {
+		buttonDown = 1;
+	}
+	else if ((buttonHistory & BUTTON_SAMPLES) == 0) {
+		buttonDown = 0;
 	}
 }
 
-// Reads the ADC output
-unsigned int read_adc(unsigned char adc_input) {
-	ADMUX = adc_input|ADC_VREF_TYPE;
-	_delay_10us(); // For stabilization of ADC input voltage.
-	ADCSRA|=(1<<ADSC); // Start the AD conversion.
-	while((ADCSRA&(1<<ADIF))==0) // Wait for AD conversion to complete.
-	;
-	ADCSRA|=(1<<ADIF);
-	return ADCW;
-}
+
 
 // Turns the LED on
 void LEDOn(void) {
-	PORTD |= 0x10;
+	LED_ON();
 }
 
 // Turns LED off
 void LEDOff(void) {
-	PORTD &= ~(0x10);
+	LED_OFF();
 }
 
 // Toggles the buzzer for jump animation
+// The buzzer is switched off by the update step so the game does not wait on it
 void buzzerToggle() {
-	PORTD |= 0x80;
-	_delay_10ms();
-	PORTD &= ~(0x80);
+	BUZZER_ON();
+	buzzerTicks = BUZZ_TICKS;
 }
 
 // Turns the buzzer on
 void buzzerOn() {
-	PORTD |= 0x80;
+	BUZZER_ON();
 }
 
 // Turns the buzzer off
 void buzzerOff() {
-	PORTD &= ~(0x80);
+	BUZZER_OFF();
 }
 
 ///////////////////////////////////////////////////////////////////////////////////////////////
@@ -1613,23 +1904,106 @@ void buzzerOff() {
 #endif
 */
 
-/* I2C clock in Hz */
+/* I2C clock in Hz the bus starts at, i2c_probe_speed() may raise it */
 #define SCL_CLOCK  100000L
 
+/* Fastest I2C clock in Hz the boot probe may try */
+#ifndef SCL_MAX_CLOCK
+#define SCL_MAX_CLOCK  1000000L
+#endif
+
+/* Number of ACKs a rate needs in a row before the probe trusts it */
+#define SCL_PROBE_TRIES  8
+
+/*
+ * TWBR and TWPS for an SCL rate, worked out by the preprocessor from F_CPU
+ * SCL = F_CPU / (16 + 2 * TWBR * 4^TWPS), the prescaler only steps in when TWBR would overflow
+ * F_CPU / 16 is the fastest SCL the TWI makes, a profile above it is left out
+ */
+#if F_CPU < 16 * SCL_CLOCK
+#error "SCL_CLOCK is faster than the TWI can clock at this F_CPU"
+#endif
+#define TWI_DIVIDER(scl)  (((F_CPU/(scl))-16)/2)
+#define TWI_TWPS(scl)     ((TWI_DIVIDER(scl) > 255*4) ? 2 : (TWI_DIVIDER(scl) > 255) ? 1 : 0)
+#define TWI_TWBR(scl)     (TWI_DIVIDER(scl) >> (2*TWI_TWPS(scl)))
+#define TWI_PROFILE(scl)  { TWI_TWBR(scl), TWI_TWPS(scl) }
+
+typedef struct {
+  uint8_t twbr;
+  uint8_t twps;
+} twi_profile_t;
+
+/* Bus speed profiles, slowest first: standard mode, fast mode and the rates most SSD1306 modules manage beyond it */
+static const twi_profile_t twi_profiles[] PROGMEM = {
+  TWI_PROFILE(SCL_CLOCK),
+#if SCL_MAX_CLOCK >= 400000L && F_CPU >= 16 * 400000L
+  TWI_PROFILE(400000L),
+#endif
+#if SCL_MAX_CLOCK >= 800000L && F_CPU >= 16 * 800000L
+  TWI_PROFILE(800000L),
+#endif
+#if SCL_MAX_CLOCK >= 1000000L && F_CPU >= 16 * 1000000L
+  TWI_PROFILE(1000000L),
+#endif
+};
+
+#define TWI_PROFILE_COUNT  (sizeof(twi_profiles) / sizeof(twi_profiles[0]))
+
+
+/* Loads the bit rate registers from one of the speed profiles */
+static void twi_set_profile(unsigned char profile)
+{
+  TWSR = pgm_read_byte(&twi_profiles[profile].twps);
+  TWBR = pgm_read_byte(&twi_profiles[profile].twbr);
+}
+
 
 /*************************************************************************
  Initialization of the I2C bus interface. Need to be called only once
 *************************************************************************/
 void i2c_init(void)
 {
-  /* initialize TWI clock: 100 kHz clock, TWPS = 0 => prescaler = 1 */
+  /* initialize TWI clock: standard mode, the first speed profile */
   
-  TWSR = 0;                         /* no prescaler */
-  TWBR = ((F_CPU/SCL_CLOCK)-16)/2;  /* must be > 10 for stable operation */
+  twi_set_profile(0);
 
 }/* i2c_init */
 
 
+/*************************************************************************
+ Steps the bus clock up through the speed profiles and keeps the fastest
+ one at which the device acknowledged its address on every try.
+ Only address bytes go out, so a rate the device cannot follow never
+ reaches it as a command or data byte.
+ Return value: index of the speed profile in use
+*************************************************************************/
+unsigned char i2c_probe_speed(unsigned char address)
+{
+  unsigned char best = 0;
+
+  for (unsigned char profile = 1; profile < TWI_PROFILE_COUNT; profile++)
+  {
+    unsigned char acks = 0;
+
+    twi_set_profile(profile);
+    for (unsigned char i = 0; i < SCL_PROBE_TRIES; i++)
+    {
+      if (i2c_start(address + I2C_WRITE) == 0) acks++;
+      i2c_stop();
+    }
+    if (acks != SCL_PROBE_TRIES) break;
+    best = profile;
+  }
+  twi_set_profile(best);
+  return best;
+
+}/* i2c_probe_speed */
+
+
+#ifndef HOST_SIM
+/* On the host the simulator implements the bus functions below */
+
+
 /*************************************************************************	
   Issues a start condition and sends address and transfer direction.
   return 0 = device accessible, 1= failed to access device
@@ -1669,13 +2043,14 @@ unsigned char i2c_start(unsigned char address)
  If device is busy, use ack polling to wait until device is ready
  
  Input:   address and transfer direction of I2C device
+ Return:  0 device accessible, 1 no ACK after I2C_WAIT_TRIES polls
 *************************************************************************/
-void i2c_start_wait(unsigned char address)
+unsigned char i2c_start_wait(unsigned char address)
 {
     uint8_t   twst;
 
 
-    while ( 1 )
+    for ( uint16_t tries = 0; tries < I2C_WAIT_TRIES; tries++ )
     {
 	    // send START condition
 	    TWCR = (1<<TWINT) | (1<<TWSTA) | (1<<TWEN);
@@ -1707,8 +2082,9 @@ void i2c_start_wait(unsigned char address)
     	    continue;
     	}
     	//if( twst != TW_MT_SLA_ACK) return 1;
-    	break;
+    	return 0;
      }
+     return 1;
 
 }/* i2c_start_wait */
 
@@ -1797,9 +2173,4 @@ unsigned char i2c_readNak(void)
 
 }/* i2c_readNak */
 
-
-
-
-
-
-
+#endif /* HOST_SIM */